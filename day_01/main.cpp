@@ -1,15 +1,203 @@
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cinttypes>
+#include <cstring>
 #include <fstream>
 #include <iostream>
-#include <map>
 #include <numeric>
+#include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
-int firstPart()
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+std::string loadInput(char const* path)
+{
+    std::ifstream      input(path, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << input.rdbuf();
+    return buffer.str();
+}
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(char const* path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error(std::string("Can't open ") + path);
+        }
+
+        struct stat status = {};
+        if ((::fstat(fd, &status) == 0) && (status.st_size > 0))
+        {
+            mSize = static_cast<std::size_t>(status.st_size);
+            mData = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mData == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error(std::string("Can't map ") + path);
+            }
+            ::madvise(mData, mSize, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (mSize != 0)
+        {
+            ::munmap(mData, mSize);
+        }
+    }
+
+    MappedFile(MappedFile const&)            = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    std::string_view view() const
+    {
+        return {static_cast<char const*>(mData), mSize};
+    }
+
+private:
+    void*       mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+inline bool isDigit(char ch)
+{
+    return static_cast<unsigned char>(ch - '0') < 10;
+}
+
+// Scalar fallback, also used for the tail of a line which is shorter than one SIMD block
+char const* findFirstDigitScalar(char const* begin, char const* end)
+{
+    for (; begin != end; ++begin)
+    {
+        if (isDigit(*begin))
+        {
+            return begin;
+        }
+    }
+    return nullptr;
+}
+
+char const* findLastDigitScalar(char const* begin, char const* end)
+{
+    while (end != begin)
+    {
+        if (isDigit(*--end))
+        {
+            return end;
+        }
+    }
+    return nullptr;
+}
+
+#if defined(__AVX2__)
+constexpr std::ptrdiff_t kBlockSize = 32;
+
+// One bit per byte of the block, set if the byte is an ASCII digit
+inline std::uint32_t digitMask(char const* block)
+{
+    auto bytes  = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(block));
+    auto offset = _mm256_sub_epi8(bytes, _mm256_set1_epi8('0'));
+    // (ch - '0') <= 9 as an unsigned comparison
+    auto digits = _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(9)), offset);
+    return static_cast<std::uint32_t>(_mm256_movemask_epi8(digits));
+}
+#elif defined(__SSE2__)
+constexpr std::ptrdiff_t kBlockSize = 16;
+
+// One bit per byte of the block, set if the byte is an ASCII digit
+inline std::uint32_t digitMask(char const* block)
+{
+    auto bytes  = _mm_loadu_si128(reinterpret_cast<__m128i const*>(block));
+    auto offset = _mm_sub_epi8(bytes, _mm_set1_epi8('0'));
+    // (ch - '0') <= 9 as an unsigned comparison
+    auto digits = _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(9)), offset);
+    return static_cast<std::uint32_t>(_mm_movemask_epi8(digits));
+}
+#endif
+
+char const* findFirstDigit(char const* begin, char const* end)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; (end - begin) >= kBlockSize; begin += kBlockSize)
+    {
+        if (auto mask = digitMask(begin))
+        {
+            return begin + __builtin_ctz(mask);
+        }
+    }
+#endif
+    return findFirstDigitScalar(begin, end);
+}
+
+char const* findLastDigit(char const* begin, char const* end)
+{
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; (end - begin) >= kBlockSize; end -= kBlockSize)
+    {
+        if (auto mask = digitMask(end - kBlockSize))
+        {
+            return end - kBlockSize + (31 - __builtin_clz(mask));
+        }
+    }
+#endif
+    return findLastDigitScalar(begin, end);
+}
+
+// Calls visit(lineBegin, lineEnd) for every line in text, the newline itself is excluded
+template <typename Visitor>
+void forEachLine(std::string_view text, Visitor&& visit)
+{
+    char const* pos = text.data();
+    char const* end = text.data() + text.size();
+    while (pos < end)
+    {
+        auto lineEnd = static_cast<char const*>(std::memchr(pos, '\n', end - pos));
+        if (lineEnd == nullptr)
+        {
+            lineEnd = end;
+        }
+        visit(pos, lineEnd);
+        pos = lineEnd + 1;
+    }
+}
+
+std::uint64_t firstPart(std::string_view input)
+{
+    std::uint64_t score = 0;
+    forEachLine(input, [&score](char const* begin, char const* end) {
+        // Last digit is searched backwards from the newline and can't be before the first one
+        if (auto first = findFirstDigit(begin, end))
+        {
+            auto last = findLastDigit(first, end);
+            score += 10 * (*first - '0') + (*last - '0');
+        }
+    });
+    return score;
+}
+
+// Original getline based implementation, kept as a baseline for the benchmark
+int firstPartGetline(std::istream& input)
 {
-    std::fstream     input("input.txt");
     std::string      line;
     std::vector<int> calibrationValues;
     char const*      digits = "0123456789";
@@ -30,60 +218,228 @@ int firstPart()
     return std::accumulate(calibrationValues.begin(), calibrationValues.end(), 0);
 }
 
-int secondPart()
+// Aho-Corasick automaton over the spelled digits, built at compile time. The reversed variant matches the words
+// written backwards, so feeding it a line from the end finds the last spelled digit first.
+constexpr std::array<std::string_view, 9> kSpelledDigits{
+    "one", "two", "three", "four", "five", "six", "seven", "eight", "nine"};
+
+struct SpelledDigitMatcher
 {
-    std::fstream     input("input.txt");
-    std::string      line;
-    std::vector<int> calibrationValues;
-    char const*      digits = "0123456789";
-    std::array<std::string, 9> const
-        digitStrings{"one", "two", "three", "four", "five", "six", "seven", "eight", "nine"};
+    static constexpr std::size_t kMaxStates = 64;
+    static constexpr std::size_t kAlphabet  = 26;
 
-    while (std::getline(input, line))
+    std::array<std::array<std::uint8_t, kAlphabet>, kMaxStates> next{};
+    std::array<std::uint8_t, kMaxStates>                        value{};  // digit matched in the state, 0 if none
+};
+
+constexpr SpelledDigitMatcher buildMatcher(bool reversed)
+{
+    constexpr auto kAlphabet = SpelledDigitMatcher::kAlphabet;
+
+    SpelledDigitMatcher matcher{};
+    // Trie edges, 0 marks a missing edge as the root is never a target
+    std::array<std::array<std::uint8_t, kAlphabet>, SpelledDigitMatcher::kMaxStates> trie{};
+    std::uint8_t                                                                       states = 1;
+    for (std::size_t digit = 1; digit <= kSpelledDigits.size(); digit++)
     {
-        if (!line.empty())
+        auto const&  word  = kSpelledDigits[digit - 1];
+        std::uint8_t state = 0;
+        for (std::size_t idx = 0; idx < word.size(); idx++)
         {
-            std::map<size_t, int> digitPositions;
-
-            // Numerical digits, potentially not present
-            auto first = line.find_first_of(digits);
-            auto last  = line.find_last_of(digits);
+            auto letter = (reversed ? word[word.size() - 1 - idx] : word[idx]) - 'a';
+            if (trie[state][letter] == 0)
+            {
+                trie[state][letter] = states++;
+            }
+            state = trie[state][letter];
+        }
+        matcher.value[state] = static_cast<std::uint8_t>(digit);
+    }
 
-            if ((first != std::string::npos) && (last != std::string::npos))
+    // Breadth first over the trie to resolve failure links into a complete transition table
+    std::array<std::uint8_t, SpelledDigitMatcher::kMaxStates> fail{};
+    std::array<std::uint8_t, SpelledDigitMatcher::kMaxStates> queue{};
+    std::size_t                                               head = 0;
+    std::size_t                                               tail = 0;
+    for (std::size_t letter = 0; letter < kAlphabet; letter++)
+    {
+        matcher.next[0][letter] = trie[0][letter];
+        if (trie[0][letter] != 0)
+        {
+            queue[tail++] = trie[0][letter];
+        }
+    }
+    while (head < tail)
+    {
+        auto state = queue[head++];
+        if (matcher.value[state] == 0)
+        {
+            matcher.value[state] = matcher.value[fail[state]];
+        }
+        for (std::size_t letter = 0; letter < kAlphabet; letter++)
+        {
+            auto child = trie[state][letter];
+            if (child != 0)
             {
-                digitPositions[first] = line[first] - '0';
-                digitPositions[last]  = line[last] - '0';
+                fail[child]                 = matcher.next[fail[state]][letter];
+                matcher.next[state][letter] = child;
+                queue[tail++]               = child;
             }
+            else
+            {
+                matcher.next[state][letter] = matcher.next[fail[state]][letter];
+            }
+        }
+    }
+    return matcher;
+}
+
+constexpr SpelledDigitMatcher kForwardMatcher  = buildMatcher(false);
+constexpr SpelledDigitMatcher kBackwardMatcher = buildMatcher(true);
+
+// Digit value matched after feeding ch to the matcher, -1 if there is no match yet
+inline int matchDigit(SpelledDigitMatcher const& matcher, std::uint8_t& state, char ch)
+{
+    if (isDigit(ch))
+    {
+        return ch - '0';
+    }
+    auto letter = static_cast<unsigned char>(ch - 'a');
+    state       = (letter < SpelledDigitMatcher::kAlphabet) ? matcher.next[state][letter] : 0;
+    return (matcher.value[state] != 0) ? matcher.value[state] : -1;
+}
 
-            int idx = 0;
-            std::for_each(
-                digitStrings.begin(),
-                digitStrings.end(),
-                [&line, &idx, &digitPositions](std::string const& digit) {
-                    idx++;
-
-                    // String digit might be repeated several times, we have to iterate over a complete string for each
-                    // digit substring, not just find the first one
-                    for (size_t pos = 0; pos != std::string::npos;)
-                    {
-                        pos = line.find(digit, pos);
-                        if (pos != std::string::npos)
-                        {
-                            // Found substring, store position
-                            digitPositions[pos] = idx;
-                            pos += digit.size();  // move position past the digit substring position in string
-                        }
-                    }
-                });
-            calibrationValues.push_back(digitPositions.begin()->second * 10 + digitPositions.rbegin()->second);
+// No word is contained in another one, so the match which ends first is also the one which starts first.
+// Returns -1 if the line has no digits at all.
+int firstDigitValue(char const* begin, char const* end)
+{
+    std::uint8_t state = 0;
+    for (; begin != end; ++begin)
+    {
+        if (auto digit = matchDigit(kForwardMatcher, state, *begin); digit >= 0)
+        {
+            return digit;
         }
     }
+    return -1;
+}
 
-    return std::accumulate(calibrationValues.begin(), calibrationValues.end(), 0);
+int lastDigitValue(char const* begin, char const* end)
+{
+    std::uint8_t state = 0;
+    while (end != begin)
+    {
+        --end;
+        if (auto digit = matchDigit(kBackwardMatcher, state, *end); digit >= 0)
+        {
+            return digit;
+        }
+    }
+    return -1;
+}
+
+std::uint64_t secondPart(std::string_view input)
+{
+    std::uint64_t score = 0;
+    forEachLine(input, [&score](char const* begin, char const* end) {
+        auto first = firstDigitValue(begin, end);
+        if (first >= 0)
+        {
+            score += 10 * first + lastDigitValue(begin, end);
+        }
+    });
+    return score;
 }
 
-int main()
+// Splits input into newline aligned chunks, one per thread, and solves both parts on each of them
+std::pair<std::uint64_t, std::uint64_t> solveParallel(std::string_view input, unsigned threadCount)
 {
-    std::cout << "First part: " << firstPart() << std::endl;
-    std::cout << "Second part: " << secondPart() << std::endl;
-}
\ No newline at end of file
+    std::vector<std::string_view> chunks;
+    std::size_t                   begin = 0;
+    for (unsigned idx = 1; idx <= threadCount; idx++)
+    {
+        std::size_t end = input.size() * idx / threadCount;
+        if (end < input.size())
+        {
+            // Move chunk end just past the next newline, so no line is split between two chunks
+            end = input.find('\n', std::max(end, begin));
+            end = (end == std::string_view::npos) ? input.size() : end + 1;
+        }
+        if (end > begin)
+        {
+            chunks.push_back(input.substr(begin, end - begin));
+            begin = end;
+        }
+    }
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> partialScores(chunks.size());
+    std::vector<std::thread>                              workers;
+    for (std::size_t idx = 0; idx < chunks.size(); idx++)
+    {
+        workers.emplace_back([&chunks, &partialScores, idx]() {
+            partialScores[idx] = {firstPart(chunks[idx]), secondPart(chunks[idx])};
+        });
+    }
+
+    std::pair<std::uint64_t, std::uint64_t> score{0, 0};
+    for (std::size_t idx = 0; idx < workers.size(); idx++)
+    {
+        workers[idx].join();
+        score.first += partialScores[idx].first;
+        score.second += partialScores[idx].second;
+    }
+    return score;
+}
+
+template <typename Function>
+double measureSeconds(int iterations, Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        function();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+
+// Both are timed over the same in-memory copy of the input, so only the line scanning is measured
+void benchmark(char const* path, int iterations)
+{
+    auto const    input         = loadInput(path);
+    int           getlineResult = 0;
+    std::uint64_t scannerResult = 0;
+    double        getlineTime   = measureSeconds(iterations, [&]() {
+        std::istringstream stream(input);
+        getlineResult = firstPartGetline(stream);
+    });
+    double        scannerTime   = measureSeconds(iterations, [&]() { scannerResult = firstPart(input); });
+
+    double megabytes = static_cast<double>(input.size()) / (1024 * 1024);
+    std::cout << "getline: " << getlineResult << " " << megabytes / getlineTime << " MB/s" << std::endl;
+    std::cout << "scanner: " << scannerResult << " " << megabytes / scannerTime << " MB/s" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: day_01 [--bench [iterations]] [--threads count]
+    std::string_view mode = (argc > 1) ? argv[1] : "";
+    if (mode == "--bench")
+    {
+        benchmark("input.txt", (argc > 2) ? std::stoi(argv[2]) : 10);
+        return 0;
+    }
+
+    MappedFile input("input.txt");
+    if (mode == "--threads")
+    {
+        unsigned threadCount = (argc > 2) ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+        auto     score       = solveParallel(input.view(), std::max(threadCount, 1U));
+        std::cout << "First part: " << score.first << std::endl;
+        std::cout << "Second part: " << score.second << std::endl;
+        return 0;
+    }
+
+    std::cout << "First part: " << firstPart(input.view()) << std::endl;
+    std::cout << "Second part: " << secondPart(input.view()) << std::endl;
+}
@@ -1,33 +1,137 @@
-
 #include <algorithm>
+#include <chrono>
 #include <cinttypes>
 #include <fstream>
 #include <iostream>
 #include <map>
+#include <memory>
 #include <numeric>
+#include <random>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
-using Set = std::map<std::string, int>;
+struct Set
+{
+    std::uint32_t red   = 0;
+    std::uint32_t green = 0;
+    std::uint32_t blue  = 0;
+};
+
+// Both parts only depend on the maximum count of each colour within a game, so only those are kept.
+// Stored column-wise, 16 bytes per game, so the scoring loops run over contiguous arrays.
+struct GameMaxima
+{
+    std::vector<std::uint32_t> gameIds;
+    std::vector<std::uint32_t> red;
+    std::vector<std::uint32_t> green;
+    std::vector<std::uint32_t> blue;
+
+    std::size_t size() const
+    {
+        return gameIds.size();
+    }
+
+    void push_back(std::uint32_t gameId, Set const& maxima)
+    {
+        gameIds.push_back(gameId);
+        red.push_back(maxima.red);
+        green.push_back(maxima.green);
+        blue.push_back(maxima.blue);
+    }
+};
+
+std::string loadInput(char const* path)
+{
+    std::ifstream      input(path, std::ios::binary);
+    std::ostringstream buffer;
+    buffer << input.rdbuf();
+    return buffer.str();
+}
+
+std::uint32_t parseNumber(std::string_view line, std::size_t& pos)
+{
+    std::uint32_t number = 0;
+    for (; (pos < line.size()) && (line[pos] >= '0') && (line[pos] <= '9'); pos++)
+    {
+        number = number * 10 + (line[pos] - '0');
+    }
+    return number;
+}
+
+// Single pass over "Game <id>: <count> <colour>, ...; ...". Maximum over all sets is the same as the maximum
+// over all cube counts of the game, so set boundaries don't need to be tracked.
+void parseGame(std::string_view line, GameMaxima& games)
+{
+    auto pos = line.find(':');
+    if (pos == std::string_view::npos)
+    {
+        return;
+    }
+
+    auto idPos  = line.find_first_of("0123456789");
+    auto gameId = parseNumber(line, idPos);
+    Set  maxima;
+    while (pos < line.size())
+    {
+        // pos is at one of the ':', ',' or ';' separators
+        pos        = line.find_first_not_of(' ', pos + 1);
+        auto count = parseNumber(line, pos);
+        pos        = line.find_first_not_of(' ', pos);
+        char color = (pos < line.size()) ? line[pos] : '\0';
+        pos        = std::min(line.find_first_of(",;", pos), line.size());
+
+        switch (color)
+        {
+        case 'r':
+            maxima.red = std::max(maxima.red, count);
+            break;
+        case 'g':
+            maxima.green = std::max(maxima.green, count);
+            break;
+        case 'b':
+            maxima.blue = std::max(maxima.blue, count);
+            break;
+        default:
+            break;
+        }
+    }
+    games.push_back(gameId, maxima);
+}
+
+GameMaxima parseGames(std::string_view input)
+{
+    GameMaxima games;
+    while (!input.empty())
+    {
+        auto lineEnd = std::min(input.find('\n'), input.size());
+        parseGame(input.substr(0, lineEnd), games);
+        input.remove_prefix(std::min(lineEnd + 1, input.size()));
+    }
+    return games;
+}
+
+// Original stream based parser, kept as a baseline for the benchmark
+using LegacySet = std::map<std::string, int>;
 
-struct Game
+struct LegacyGame
 {
-    int              gameId;
-    std::vector<Set> sets;
+    int                    gameId;
+    std::vector<LegacySet> sets;
 };
 
-std::vector<Game> parseGame()
+std::vector<LegacyGame> parseGameStringStream(std::istream& input)
 {
-    std::vector<Game> games;
-    std::fstream      input("input.txt");
-    std::string       line;
+    std::vector<LegacyGame> games;
+    std::string             line;
     while (std::getline(input, line))
     {
         if (!line.empty())
         {
-            Game game;
-            auto beginPos = line.find_first_of(':');
+            LegacyGame game;
+            auto       beginPos = line.find_first_of(':');
             // parse game ID
             std::string        gameIdStr(line.begin(), line.begin() + beginPos);
             std::istringstream gameIdSs(gameIdStr);
@@ -75,58 +179,229 @@ std::vector<Game> parseGame()
     return games;
 }
 
-int firstPart(std::vector<Game> const& games)
+std::uint64_t firstPart(GameMaxima const& games, Set const& cubesCount = Set{12, 13, 14})
+{
+    auto const* gameIds = games.gameIds.data();
+    auto const* red     = games.red.data();
+    auto const* green   = games.green.data();
+    auto const* blue    = games.blue.data();
+
+    std::uint64_t score = 0;
+    for (std::size_t idx = 0; idx < games.size(); idx++)
+    {
+        // Branchless, so the loop is vectorized
+        std::uint32_t gamePossible =
+            (red[idx] <= cubesCount.red) & (green[idx] <= cubesCount.green) & (blue[idx] <= cubesCount.blue);
+        score += gamePossible * gameIds[idx];
+    }
+    return score;
+}
+
+std::uint64_t secondPart(GameMaxima const& games)
+{
+    auto const* red   = games.red.data();
+    auto const* green = games.green.data();
+    auto const* blue  = games.blue.data();
+
+    std::uint64_t score = 0;
+    for (std::size_t idx = 0; idx < games.size(); idx++)
+    {
+        score += static_cast<std::uint64_t>(red[idx]) * green[idx] * blue[idx];
+    }
+    return score;
+}
+
+// Answers firstPart for many bags at once. Maxima of each colour are compressed to their distinct values and a
+// 3D prefix sum over the (red, green, blue) ranks holds, per cell, the ID sum of all games whose maxima are at or
+// below that cell. A query is then three binary searches and one lookup instead of a scan over all games.
+class BagLimitIndex
 {
-    std::map<std::string, int> const cubesCount{{"red", 12}, {"green", 13}, {"blue", 14}};
+public:
+    // Grid is sized by the number of distinct maxima per colour, which is small for cube counts
+    static constexpr std::size_t kMaxCells = 1 << 24;
 
-    int score = 0;
-    for (auto const& game : games)
+    explicit BagLimitIndex(GameMaxima const& games)
+    : mRed(distinctValues(games.red))
+    , mGreen(distinctValues(games.green))
+    , mBlue(distinctValues(games.blue))
     {
-        bool gamePossible = true;
-        for (auto const& set : game.sets)
+        // Rank 0 of every axis stands for a limit below the smallest maximum
+        std::size_t const cells = (mRed.size() + 1) * (mGreen.size() + 1) * (mBlue.size() + 1);
+        if (cells > kMaxCells)
         {
-            for (auto cubeItr : set)
+            throw std::length_error("Too many distinct cube counts for the bag limit index");
+        }
+        mGrid.resize(cells, 0);
+
+        for (std::size_t idx = 0; idx < games.size(); idx++)
+        {
+            mGrid[cell(rank(mRed, games.red[idx]), rank(mGreen, games.green[idx]), rank(mBlue, games.blue[idx]))] +=
+                games.gameIds[idx];
+        }
+
+        // Prefix sums along each axis in turn
+        for (std::size_t r = 0; r <= mRed.size(); r++)
+        {
+            for (std::size_t g = 0; g <= mGreen.size(); g++)
+            {
+                for (std::size_t b = 1; b <= mBlue.size(); b++)
+                {
+                    mGrid[cell(r, g, b)] += mGrid[cell(r, g, b - 1)];
+                }
+            }
+        }
+        for (std::size_t r = 0; r <= mRed.size(); r++)
+        {
+            for (std::size_t g = 1; g <= mGreen.size(); g++)
+            {
+                for (std::size_t b = 0; b <= mBlue.size(); b++)
+                {
+                    mGrid[cell(r, g, b)] += mGrid[cell(r, g - 1, b)];
+                }
+            }
+        }
+        for (std::size_t r = 1; r <= mRed.size(); r++)
+        {
+            for (std::size_t g = 0; g <= mGreen.size(); g++)
             {
-                if (cubeItr.second > cubesCount.at(cubeItr.first))
+                for (std::size_t b = 0; b <= mBlue.size(); b++)
                 {
-                    gamePossible = false;
-                    break;
+                    mGrid[cell(r, g, b)] += mGrid[cell(r - 1, g, b)];
                 }
             }
         }
+    }
+
+    // Sum of IDs of the games possible with the given bag
+    std::uint64_t query(Set const& bag) const
+    {
+        return mGrid[cell(rank(mRed, bag.red), rank(mGreen, bag.green), rank(mBlue, bag.blue))];
+    }
 
-        if (gamePossible)
+    std::vector<std::uint64_t> query(std::vector<Set> const& bags) const
+    {
+        std::vector<std::uint64_t> scores;
+        scores.reserve(bags.size());
+        for (auto const& bag : bags)
         {
-            score += game.gameId;
+            scores.push_back(query(bag));
         }
+        return scores;
     }
-    return score;
+
+private:
+    static std::vector<std::uint32_t> distinctValues(std::vector<std::uint32_t> values)
+    {
+        std::sort(values.begin(), values.end());
+        values.erase(std::unique(values.begin(), values.end()), values.end());
+        return values;
+    }
+
+    // Number of distinct values which are less or equal to value
+    static std::size_t rank(std::vector<std::uint32_t> const& values, std::uint32_t value)
+    {
+        return std::upper_bound(values.begin(), values.end(), value) - values.begin();
+    }
+
+    std::size_t cell(std::size_t r, std::size_t g, std::size_t b) const
+    {
+        return (r * (mGreen.size() + 1) + g) * (mBlue.size() + 1) + b;
+    }
+
+    std::vector<std::uint32_t> mRed;
+    std::vector<std::uint32_t> mGreen;
+    std::vector<std::uint32_t> mBlue;
+    std::vector<std::uint64_t> mGrid;
+};
+
+template <typename Function>
+double measureSeconds(int iterations, Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++)
+    {
+        function();
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
 }
 
-int secondPart(std::vector<Game> const& games)
+void benchmark(std::string const& input, int iterations)
 {
-    int score = 0;
-    for (auto const& game : games)
+    std::size_t streamGames = 0;
+    std::size_t parserGames = 0;
+    double      streamTime  = measureSeconds(iterations, [&]() {
+        std::istringstream stream(input);
+        streamGames = parseGameStringStream(stream).size();
+    });
+    double      parserTime  = measureSeconds(iterations, [&]() { parserGames = parseGames(input).size(); });
+
+    std::cout << "stringstream: " << streamGames / streamTime << " games/s" << std::endl;
+    std::cout << "parser: " << parserGames / parserTime << " games/s" << std::endl;
+}
+
+// Random games and bags with cube counts in the range of the puzzle input
+void benchmarkBagLimits()
+{
+    std::mt19937                                 random(2023);
+    std::uniform_int_distribution<std::uint32_t> cubes(0, 30);
+
+    for (std::size_t gameCount : {1000, 10000, 100000, 1000000})
     {
-        Set minimumCubes{{"red", 0}, {"green", 0}, {"blue", 0}};
-        for (auto const& set : game.sets)
+        GameMaxima games;
+        for (std::size_t idx = 1; idx <= gameCount; idx++)
         {
-            for (auto setItr : set)
+            games.push_back(static_cast<std::uint32_t>(idx), Set{cubes(random), cubes(random), cubes(random)});
+        }
+
+        for (std::size_t queryCount : {10, 1000})
+        {
+            std::vector<Set> bags;
+            for (std::size_t idx = 0; idx < queryCount; idx++)
             {
-                minimumCubes[setItr.first] = std::max(minimumCubes[setItr.first], setItr.second);
+                bags.push_back(Set{cubes(random), cubes(random), cubes(random)});
             }
+
+            std::vector<std::uint64_t>     scanScores;
+            std::vector<std::uint64_t>     indexScores;
+            std::unique_ptr<BagLimitIndex> index;
+            double                         scanTime = measureSeconds(1, [&]() {
+                scanScores.clear();
+                for (auto const& bag : bags)
+                {
+                    scanScores.push_back(firstPart(games, bag));
+                }
+            });
+            double buildTime = measureSeconds(1, [&]() { index = std::make_unique<BagLimitIndex>(games); });
+            double queryTime = measureSeconds(1, [&]() { indexScores = index->query(bags); });
+
+            std::cout << gameCount << " games, " << queryCount << " bags: scan " << scanTime * 1000 << " ms, index build "
+                      << buildTime * 1000 << " ms, queries " << queryTime * 1000 << " ms"
+                      << (scanScores == indexScores ? "" : " MISMATCH") << std::endl;
         }
-        int power = minimumCubes["red"] * minimumCubes["green"] * minimumCubes["blue"];
-        score += power;
     }
-    return score;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    auto const game = parseGame();
+    auto const input = loadInput("input.txt");
+
+    // Usage: day_02 [--bench [iterations] | --bench-bags]
+    std::string_view mode = (argc > 1) ? argv[1] : "";
+    if (mode == "--bench")
+    {
+        benchmark(input, (argc > 2) ? std::stoi(argv[2]) : 10);
+        return 0;
+    }
+    if (mode == "--bench-bags")
+    {
+        benchmarkBagLimits();
+        return 0;
+    }
+
+    auto const game = parseGames(input);
     std::cout << "First part " << firstPart(game) << std::endl;
     std::cout << "Second part " << secondPart(game) << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -1,11 +1,14 @@
 #include <algorithm>
+#include <array>
 #include <cinttypes>
 #include <fstream>
 #include <iostream>
-#include <map>
 #include <numeric>
-#include <optional>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
 std::vector<std::string> loadInput()
@@ -23,197 +26,486 @@ std::vector<std::string> loadInput()
     return inputStrings;
 }
 
-std::size_t firstPart(std::vector<std::string> const& input)
+inline bool isDigit(char ch)
 {
-    const char* digits = "0123456789";
+    return (ch >= '0') && (ch <= '9');
+}
 
-    std::size_t row   = 0;
-    std::size_t score = 0;
+inline bool isSymbol(char ch)
+{
+    return (ch != '.') && !isDigit(ch);
+}
 
-    for (auto const& line : input)
+// One bit per cell of the schematic, each row packed into 64 bit words. Bit n of a word is column n of the word.
+struct BitGrid
+{
+    BitGrid(std::size_t rows, std::size_t columns)
+    : words((columns + 63) / 64)
+    , bits(rows * words, 0)
     {
-        // find number in string
-        std::size_t firstDigitPos = 0;
-        std::size_t lastDigitPos  = 0;
-        while ((firstDigitPos = line.find_first_of(digits, lastDigitPos)) != std::string::npos)
-        {
-            lastDigitPos = line.find_first_not_of(digits, firstDigitPos);  // First POS not a digit
-            if (lastDigitPos == std::string::npos)
-            {
-                lastDigitPos = line.size();
-            }
+    }
 
-            // expand search mask by 1 field in any direction and check if symbol is contained
-            auto maskBeginPos = firstDigitPos;
-            auto maskEndPos   = lastDigitPos;
+    std::uint64_t* row(std::size_t row)
+    {
+        return bits.data() + row * words;
+    }
 
-            std::size_t neighboringSymbols = 0;
+    std::uint64_t const* row(std::size_t row) const
+    {
+        return bits.data() + row * words;
+    }
 
-            if (maskBeginPos != 0)
-            {
-                // check left
-                maskBeginPos--;
-                neighboringSymbols += line[maskBeginPos] != '.';
-            }
-            if (maskEndPos != line.size())
-            {
-                // check right
-                neighboringSymbols += line[maskEndPos] != '.';
-                maskEndPos++;  // Prepare for iterators
-            }
+    std::size_t                words;
+    std::vector<std::uint64_t> bits;
+};
 
-            // check upper row
-            if (row > 0)
-            {
-                neighboringSymbols += std::any_of(
-                    input[row - 1].begin() + maskBeginPos,
-                    input[row - 1].begin() + maskEndPos,
-                    [](char const ch) { return ch != '.'; });
-            }
+// Word of the row mask with every cell moved one column to the right
+inline std::uint64_t shiftedRight(std::uint64_t const* mask, std::size_t word)
+{
+    return (mask[word] << 1) | ((word > 0) ? (mask[word - 1] >> 63) : 0);
+}
 
-            // check lower row
-            if (row < (input.size() - 1))
-            {
-                neighboringSymbols += std::any_of(
-                    input[row + 1].begin() + maskBeginPos,
-                    input[row + 1].begin() + maskEndPos,
-                    [](char const ch) { return ch != '.'; });
-            }
+// Word of the row mask with every cell moved one column to the left
+inline std::uint64_t shiftedLeft(std::uint64_t const* mask, std::size_t word, std::size_t words)
+{
+    return (mask[word] >> 1) | (((word + 1) < words) ? (mask[word + 1] << 63) : 0);
+}
+
+// Digit mask and symbol mask of one row. Symbols are dilated by one cell horizontally, so OR-ing the symbol masks
+// of the rows above, at and below a row gives all of its cells adjacent to a symbol.
+void maskRow(std::string_view line, std::uint64_t* digits, std::uint64_t* symbols, std::size_t words)
+{
+    std::fill(digits, digits + words, 0);
+    std::fill(symbols, symbols + words, 0);
+    for (std::size_t column = 0; column < line.size(); column++)
+    {
+        auto bit = std::uint64_t{1} << (column % 64);
+        digits[column / 64] |= isDigit(line[column]) ? bit : 0;
+        symbols[column / 64] |= isSymbol(line[column]) ? bit : 0;
+    }
 
-            if (neighboringSymbols != 0)
+    // In place, the next word is still undilated when the current one is processed
+    std::uint64_t previous = 0;
+    for (std::size_t word = 0; word < words; word++)
+    {
+        auto current   = symbols[word];
+        auto next      = ((word + 1) < words) ? symbols[word + 1] : 0;
+        symbols[word]  = current | (current << 1) | (previous >> 63) | (current >> 1) | (next << 63);
+        previous       = current;
+    }
+}
+
+// Labels every digit cell of the row with the index + 1 of its number in values, other cells are left untouched
+void labelRow(std::string_view line, std::uint32_t* labels, std::vector<std::size_t>& values)
+{
+    for (std::size_t column = 0; column < line.size(); column++)
+    {
+        if (isDigit(line[column]))
+        {
+            if ((column == 0) || !isDigit(line[column - 1]))
             {
-                // convert to number and add to sum
-                std::string number(line.begin() + firstDigitPos, line.begin() + lastDigitPos);
-                score += std::stol(number);
+                // start of the number
+                values.push_back(0);
             }
+            values.back()  = values.back() * 10 + (line[column] - '0');
+            labels[column] = static_cast<std::uint32_t>(values.size());
         }
-        row++;
     }
-    return score;
 }
 
-struct PartNumber
+std::size_t maxColumns(std::vector<std::string> const& input)
 {
-    std::size_t value;
-    std::size_t columnBegin;
-    std::size_t columnEnd;
+    std::size_t columns = 0;
+    for (auto const& line : input)
+    {
+        columns = std::max(columns, line.size());
+    }
+    return columns;
+}
 
-    friend bool operator<(PartNumber const& left, PartNumber const& right)
+// Masks of the schematic rows [rowBegin, rowEnd)
+struct SchematicMasks
+{
+    SchematicMasks(std::vector<std::string> const& input, std::size_t rowBegin, std::size_t rowEnd, std::size_t columns)
+    : rowBegin(rowBegin)
+    , rowEnd(rowEnd)
+    , digits(rowEnd - rowBegin, columns)
+    , symbols(rowEnd - rowBegin, columns)
     {
-        return left.columnBegin < right.columnBegin;
+        for (std::size_t row = rowBegin; row < rowEnd; row++)
+        {
+            maskRow(input[row], digits.row(row - rowBegin), symbols.row(row - rowBegin), symbols.words);
+        }
     }
+
+    // Symbol mask of a schematic row, nullptr for rows outside of the masked ones
+    std::uint64_t const* symbolsAt(std::size_t row) const
+    {
+        return ((row >= rowBegin) && (row < rowEnd)) ? symbols.row(row - rowBegin) : nullptr;
+    }
+
+    std::size_t rowBegin;
+    std::size_t rowEnd;
+    BitGrid     digits;
+    BitGrid     symbols;  // Symbols dilated by one cell to the left and right
 };
 
-struct PartNumbers
+// Sum of the numbers in line which have at least one digit adjacent to a symbol. Symbol masks of missing rows
+// above or below are nullptr, parts is a scratch row mask.
+std::size_t sumPartNumbers(
+    std::string_view                    line,
+    std::uint64_t const*                digits,
+    std::array<std::uint64_t const*, 3> symbols,
+    std::uint64_t*                      parts,
+    std::size_t                         words)
 {
-    std::vector<PartNumber> getAdjacentTo(std::size_t column)
+    bool changed = false;
+    for (std::size_t word = 0; word < words; word++)
     {
-        std::vector<PartNumber> foundNumbers;
-        auto iter = std::lower_bound(mPartNumbers.begin(), mPartNumbers.end(), PartNumber{0, column, 0});
-        // Check if any numbers are found past column
-        if (iter != mPartNumbers.end())
+        auto adjacent = symbols[1][word];
+        adjacent |= (symbols[0] != nullptr) ? symbols[0][word] : 0;
+        adjacent |= (symbols[2] != nullptr) ? symbols[2][word] : 0;
+        parts[word] = digits[word] & adjacent;
+        changed |= parts[word] != 0;
+    }
+
+    // Grow the adjacent digits along their digit runs until they cover whole numbers
+    while (changed)
+    {
+        changed = false;
+        for (std::size_t word = 0; word < words; word++)
         {
-            // Check if found number is adjacent to colum
-            if ((iter->columnBegin == column) || (iter->columnBegin == (column + 1)))
-            {
-                foundNumbers.push_back(*iter);
-            }
+            auto grown = (parts[word] | shiftedRight(parts, word) | shiftedLeft(parts, word, words)) & digits[word];
+            changed |= grown != parts[word];
+            parts[word] = grown;
         }
+    }
 
-        // If this is not a first number in row, check if previous number is adjacent to column form left side
-        if (iter != mPartNumbers.begin())
+    std::size_t score = 0;
+    for (std::size_t word = 0; word < words; word++)
+    {
+        // First digit of each number has no digit on its left
+        for (auto starts = parts[word] & ~shiftedRight(parts, word); starts != 0; starts &= starts - 1)
         {
-            // check left
-            std::advance(iter, -1);
-            if ((iter->columnEnd >= column - 1))
+            std::size_t number = 0;
+            for (auto column = word * 64 + __builtin_ctzll(starts); (column < line.size()) && isDigit(line[column]);
+                 column++)
             {
-                foundNumbers.push_back(*iter);
+                number = number * 10 + (line[column] - '0');
             }
+            score += number;
         }
-        return foundNumbers;
     }
+    return score;
+}
 
-    std::vector<PartNumber> mPartNumbers;
-};
+// Sum of part numbers in rows [begin, end), masks have to cover one more row on each side where it exists
+std::size_t partNumbersInRows(
+    std::vector<std::string> const& input,
+    SchematicMasks const&           masks,
+    std::size_t                     begin,
+    std::size_t                     end)
+{
+    std::vector<std::uint64_t> parts(masks.symbols.words);
 
-std::size_t secondPart(std::vector<std::string> const input)
+    std::size_t score = 0;
+    for (std::size_t row = begin; row < end; row++)
+    {
+        // row - 1 wraps around for the first row, which has no symbols above it either way
+        std::array<std::uint64_t const*, 3> symbols{
+            masks.symbolsAt(row - 1), masks.symbolsAt(row), masks.symbolsAt(row + 1)};
+        score += sumPartNumbers(
+            input[row], masks.digits.row(row - masks.rowBegin), symbols, parts.data(), masks.symbols.words);
+    }
+    return score;
+}
+
+std::size_t firstPart(std::vector<std::string> const& input)
 {
-    std::map<std::size_t, PartNumbers>               numbersInRow;
-    std::vector<std::pair<std::size_t, std::size_t>> gears;
+    SchematicMasks masks(input, 0, input.size(), maxColumns(input));
+    return partNumbersInRows(input, masks, 0, input.size());
+}
 
-    std::size_t row = 0;
-    for (auto const& line : input)
+// Number labels of one row and the values they refer to
+struct LabelRow
+{
+    std::uint32_t const* labels = nullptr;
+    std::size_t const*   values = nullptr;
+};
+
+// Sum of gear ratios of the gears in line. Label rows above or below may be missing (nullptr labels).
+std::size_t sumGearRatios(std::string_view line, std::array<LabelRow, 3> const& rows, std::size_t columns)
+{
+    std::size_t score = 0;
+    for (auto column = line.find('*'); column != std::string_view::npos; column = line.find('*', column + 1))
     {
-        std::optional<std::size_t> number;
-        std::optional<std::size_t> columnBegin;
-        for (std::size_t column = 0; column < line.size(); column++)
+        std::size_t adjacentCount = 0;
+        std::size_t ratio         = 1;
+
+        auto const firstColumn = (column > 0) ? (column - 1) : column;
+        auto const lastColumn  = std::min(column + 1, columns - 1);
+        for (auto const& row : rows)
         {
-            if (std::isdigit(line[column]))
+            if (row.labels == nullptr)
             {
-                if (!number)
-                {
-                    // start of the number
-                    number      = line[column] - '0';
-                    columnBegin = column;
-                }
-                else
-                {
-                    *number *= 10;
-                    *number += line[column] - '0';
-                }
-            }
-            else if (number)  // finished parsing a number
-            {
-                // Store the parsed PartNumber
-                numbersInRow[row].mPartNumbers.push_back(PartNumber{*number, *columnBegin, column - 1});
-                // Reset optionals
-                number      = {};
-                columnBegin = {};
+                continue;
             }
 
-            if (line[column] == '*')
+            // Cells of one number are contiguous, so comparing with the previous cell is enough to deduplicate
+            std::uint32_t previous = 0;
+            for (auto neighbor = firstColumn; neighbor <= lastColumn; neighbor++)
             {
-                // This is a gear symbol
-                gears.emplace_back(row, column);
+                auto label = row.labels[neighbor];
+                if ((label != 0) && (label != previous))
+                {
+                    adjacentCount++;
+                    ratio *= row.values[label - 1];
+                }
+                previous = label;
             }
         }
 
-        // Check if number reaches the end of the row
-        if (number)
+        if (adjacentCount == 2)
+        {
+            score += ratio;
+        }
+    }
+    return score;
+}
+
+// Flat grid for the schematic rows [rowBegin, rowEnd) where every digit cell holds the index + 1 of its number in
+// values, 0 marks cells which are not part of a number
+struct NumberLabels
+{
+    NumberLabels(std::vector<std::string> const& input, std::size_t rowBegin, std::size_t rowEnd, std::size_t columns)
+    : rowBegin(rowBegin)
+    , rowEnd(rowEnd)
+    , columns(columns)
+    , labels((rowEnd - rowBegin) * columns, 0)
+    {
+        for (std::size_t row = rowBegin; row < rowEnd; row++)
         {
-            numbersInRow[row].mPartNumbers.push_back(PartNumber{*number, *columnBegin, line.size() - 1});
+            labelRow(input[row], labels.data() + (row - rowBegin) * columns, values);
         }
-        row++;
     }
 
-    // Go over all gears and search for adjacent numbers in row, row+1 and row - 1;
+    // Labels of a schematic row, empty for rows outside of the labeled ones
+    LabelRow at(std::size_t row) const
+    {
+        if ((row < rowBegin) || (row >= rowEnd))
+        {
+            return {};
+        }
+        return {labels.data() + (row - rowBegin) * columns, values.data()};
+    }
+
+    std::size_t                rowBegin;
+    std::size_t                rowEnd;
+    std::size_t                columns;
+    std::vector<std::uint32_t> labels;
+    std::vector<std::size_t>   values;
+};
+
+// Sum of gear ratios in rows [begin, end), labels have to cover one more row on each side where it exists
+std::size_t gearRatiosInRows(
+    std::vector<std::string> const& input,
+    NumberLabels const&             numbers,
+    std::size_t                     begin,
+    std::size_t                     end)
+{
     std::size_t score = 0;
-    for (auto& gear : gears)
+    for (std::size_t row = begin; row < end; row++)
     {
-        auto partNumbers = numbersInRow[gear.first].getAdjacentTo(gear.second);
-        if (gear.first > 0)
+        std::array<LabelRow, 3> rows{numbers.at(row - 1), numbers.at(row), numbers.at(row + 1)};
+        score += sumGearRatios(input[row], rows, numbers.columns);
+    }
+    return score;
+}
+
+std::size_t secondPart(std::vector<std::string> const& input)
+{
+    NumberLabels numbers(input, 0, input.size(), maxColumns(input));
+    return gearRatiosInRows(input, numbers, 0, input.size());
+}
+
+// Splits the schematic into horizontal bands scored on separate threads. Each band builds its masks and labels
+// with one halo row above and below, but only scores its own rows, so numbers and gears on band boundaries are
+// counted exactly once, by the band of the row they are in.
+std::pair<std::size_t, std::size_t> solveParallel(std::vector<std::string> const& input, unsigned threadCount)
+{
+    auto const columns   = maxColumns(input);
+    auto const bandCount = std::max<std::size_t>(std::min<std::size_t>(threadCount, input.size()), 1);
+
+    std::vector<std::pair<std::size_t, std::size_t>> partialScores(bandCount);
+    std::vector<std::thread>                          workers;
+    for (std::size_t band = 0; band < bandCount; band++)
+    {
+        workers.emplace_back([&input, &partialScores, columns, bandCount, band]() {
+            auto const begin     = input.size() * band / bandCount;
+            auto const end       = input.size() * (band + 1) / bandCount;
+            auto const haloBegin = (begin > 0) ? (begin - 1) : begin;
+            auto const haloEnd   = std::min(end + 1, input.size());
+
+            SchematicMasks masks(input, haloBegin, haloEnd, columns);
+            NumberLabels   numbers(input, haloBegin, haloEnd, columns);
+            partialScores[band] = {
+                partNumbersInRows(input, masks, begin, end), gearRatiosInRows(input, numbers, begin, end)};
+        });
+    }
+
+    std::pair<std::size_t, std::size_t> score{0, 0};
+    for (std::size_t band = 0; band < bandCount; band++)
+    {
+        workers[band].join();
+        score.first += partialScores[band].first;
+        score.second += partialScores[band].second;
+    }
+    return score;
+}
+
+// Streaming evaluation over a ring buffer of three rows. A row is scored as soon as the row below it arrives, or
+// the input ends, so memory use doesn't depend on the number of rows.
+class SchematicStream
+{
+public:
+    void push(std::string_view line)
+    {
+        if (line.size() > mColumns)
+        {
+            // Cells past the end of shorter rows are empty, but the stored rows are masked again as the dilation of a
+            // symbol in the old last column spills into the new word
+            mColumns = line.size();
+            mWords   = (mColumns + 63) / 64;
+            for (auto& row : mRows)
+            {
+                row.digits.resize(mWords);
+                row.symbols.resize(mWords);
+                row.labels.resize(mColumns, 0);
+                maskRow(row.line, row.digits.data(), row.symbols.data(), mWords);
+            }
+            mParts.resize(mWords);
+        }
+
+        auto& row = mRows[mCount % mRows.size()];
+        row.line.assign(line);
+        maskRow(row.line, row.digits.data(), row.symbols.data(), mWords);
+        std::fill(row.labels.begin(), row.labels.end(), 0);
+        row.values.clear();
+        labelRow(row.line, row.labels.data(), row.values);
+
+        if (mCount > 0)
         {
-            auto previousRow = numbersInRow[gear.first - 1].getAdjacentTo(gear.second);
-            partNumbers.insert(partNumbers.end(), previousRow.begin(), previousRow.end());
+            scoreRow(mCount - 1, true);
         }
-        if (gear.first < (input.size() - 1))
+        mCount++;
+    }
+
+    // Scores the last row, which has no row below it
+    void finish()
+    {
+        if (mCount > 0)
         {
-            auto nextRow = numbersInRow[gear.first + 1].getAdjacentTo(gear.second);
-            partNumbers.insert(partNumbers.end(), nextRow.begin(), nextRow.end());
+            scoreRow(mCount - 1, false);
         }
+    }
+
+    std::size_t partNumbers() const
+    {
+        return mPartNumbers;
+    }
+
+    std::size_t gearRatios() const
+    {
+        return mGearRatios;
+    }
+
+private:
+    struct Row
+    {
+        std::string                line;
+        std::vector<std::uint64_t> digits;
+        std::vector<std::uint64_t> symbols;
+        std::vector<std::uint32_t> labels;
+        std::vector<std::size_t>   values;
+    };
+
+    void scoreRow(std::size_t index, bool hasBelow)
+    {
+        auto const* above = (index > 0) ? &mRows[(index - 1) % mRows.size()] : nullptr;
+        auto const& row   = mRows[index % mRows.size()];
+        auto const* below = hasBelow ? &mRows[(index + 1) % mRows.size()] : nullptr;
+
+        std::array<std::uint64_t const*, 3> symbols{
+            above ? above->symbols.data() : nullptr, row.symbols.data(), below ? below->symbols.data() : nullptr};
+        mPartNumbers += sumPartNumbers(row.line, row.digits.data(), symbols, mParts.data(), mWords);
+
+        std::array<LabelRow, 3> labels{
+            above ? LabelRow{above->labels.data(), above->values.data()} : LabelRow{},
+            LabelRow{row.labels.data(), row.values.data()},
+            below ? LabelRow{below->labels.data(), below->values.data()} : LabelRow{}};
+        mGearRatios += sumGearRatios(row.line, labels, mColumns);
+    }
 
-        if (partNumbers.size() == 2)
+    std::array<Row, 3>         mRows;
+    std::vector<std::uint64_t> mParts;
+    std::size_t                mCount       = 0;
+    std::size_t                mColumns     = 0;
+    std::size_t                mWords       = 0;
+    std::size_t                mPartNumbers = 0;
+    std::size_t                mGearRatios  = 0;
+};
+
+std::pair<std::size_t, std::size_t> streamInput(std::istream& input)
+{
+    SchematicStream stream;
+    std::string     line;
+    while (std::getline(input, line))
+    {
+        if (!line.empty())
         {
-            score += partNumbers.front().value * partNumbers.back().value;
+            stream.push(line);
         }
     }
-    return score;
+    stream.finish();
+    return {stream.partNumbers(), stream.gearRatios()};
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    // Usage: day_03 [--stream [file] | --threads [count]], streaming mode reads stdin when no file or "-" is given
+    std::string_view mode = (argc > 1) ? argv[1] : "";
+    if (mode == "--stream")
+    {
+        std::pair<std::size_t, std::size_t> score;
+        if ((argc > 2) && (std::string_view(argv[2]) != "-"))
+        {
+            std::ifstream input(argv[2]);
+            if (!input)
+            {
+                throw std::runtime_error("Unable to open " + std::string(argv[2]));
+            }
+            score = streamInput(input);
+        }
+        else
+        {
+            score = streamInput(std::cin);
+        }
+        std::cout << "First part: " << score.first << std::endl;
+        std::cout << "Second part: " << score.second << std::endl;
+        return 0;
+    }
+
     auto input = loadInput();
+    if (mode == "--threads")
+    {
+        unsigned threadCount = (argc > 2) ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+        auto     score       = solveParallel(input, threadCount);
+        std::cout << "First part: " << score.first << std::endl;
+        std::cout << "Second part: " << score.second << std::endl;
+        return 0;
+    }
+
     std::cout << "First part: " << firstPart(input) << std::endl;
     std::cout << "Second part: " << secondPart(input) << std::endl;
     return 0;
-}
\ No newline at end of file
+}
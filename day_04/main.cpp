@@ -1,22 +1,76 @@
 #include <algorithm>
+#include <array>
+#include <bitset>
 #include <cinttypes>
+#include <exception>
 #include <fstream>
 #include <iostream>
-#include <numeric>
-#include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
 #include <vector>
 
+// Card numbers are small, so a set of them is a fixed width bitset and matching is an AND and a popcount
+constexpr std::size_t kMaxCardNumber = 128;
+using NumberSet                      = std::bitset<kMaxCardNumber>;
+
 struct Card
 {
-    std::set<std::size_t> winningNumbers;
-    std::set<std::size_t> ticketNumbers;
-    std::size_t           cardNumber;
-    std::size_t           matches    = 0;
-    std::size_t           cardsCount = 1;
+    std::size_t   cardNumber;
+    std::size_t   matches    = 0;
+    std::uint64_t cardsCount = 1;
 };
 
+// Allocation free match counting, numbers before the '|' are the winning ones and the ones after it the ticket ones
+std::size_t countMatches(std::string_view line)
+{
+    NumberSet   winningNumbers;
+    NumberSet   ticketNumbers;
+    NumberSet*  numbers  = &winningNumbers;
+    std::size_t number   = 0;
+    bool        inNumber = false;
+
+    auto addNumber = [&]() {
+        if (inNumber)
+        {
+            if (number >= kMaxCardNumber)
+            {
+                throw std::out_of_range("Card number doesn't fit into NumberSet");
+            }
+            numbers->set(number);
+            number   = 0;
+            inNumber = false;
+        }
+    };
+
+    for (auto pos = line.find(':'); pos < line.size(); pos++)
+    {
+        char ch = line[pos];
+        if ((ch >= '0') && (ch <= '9'))
+        {
+            number   = number * 10 + (ch - '0');
+            inNumber = true;
+            continue;
+        }
+        addNumber();
+        if (ch == '|')
+        {
+            numbers = &ticketNumbers;
+        }
+    }
+    addNumber();
+    return (winningNumbers & ticketNumbers).count();
+}
+
+// Lines without the "Card x:" prefix are skipped
+bool isCardLine(std::string_view line)
+{
+    return line.find(':') != std::string_view::npos;
+}
+
 std::vector<Card> loadInput()
 {
     std::fstream input("input.txt");
@@ -25,88 +79,375 @@ std::vector<Card> loadInput()
     std::vector<Card> cards;
     while (std::getline(input, line))
     {
-        if (!line.empty())
+        if (isCardLine(line))
         {
-            std::string       token;
-            std::stringstream iss(line);
-            iss >> token;  // Push out "Card" string
-            iss >> token;  // Push out "x:"
-            Card card;
-            bool parsingWinningNumbers = true;
-            while (!iss.eof())
-            {
-                iss >> token;
-                if (token == "|")
-                {
-                    parsingWinningNumbers = false;
-                }
-                else
-                {
-                    card.cardNumber = cards.size();
-                    auto number    = std::stoul(token);
-                    if (parsingWinningNumbers)
-                    {
-                        card.winningNumbers.insert(number);
-                    }
-                    else
-                    {
-                        card.ticketNumbers.insert(number);
-                    }
-                }
-            }
-            cards.push_back(std::move(card));
+            cards.push_back(Card{cards.size(), countMatches(line)});
         }
     }
     return cards;
 }
 
-size_t partOne(std::vector<Card>& cards)
+// Points double with each match, so more than 64 matches no longer fit the score
+std::uint64_t cardPoints(std::size_t matches)
 {
-    std::size_t score = 0;
+    if (matches > 64)
+    {
+        throw std::overflow_error("Card with " + std::to_string(matches) + " matches overflows 64 bit points");
+    }
+    return (matches != 0) ? (std::uint64_t{1} << (matches - 1)) : 0;
+}
 
-    for (auto& card : cards)
+// Sums of points and copies only grow, every partial sum is bounded by the answer. So once one doesn't fit 64 bits
+// neither does the answer, and it's reported instead of wrapping around.
+std::uint64_t addChecked(std::uint64_t left, std::uint64_t right)
+{
+    std::uint64_t sum = 0;
+    if (__builtin_add_overflow(left, right, &sum))
+    {
+        throw std::overflow_error("Card total overflows 64 bits");
+    }
+    return sum;
+}
+
+std::uint64_t multiplyChecked(std::uint64_t left, std::uint64_t right)
+{
+    std::uint64_t product = 0;
+    if (__builtin_mul_overflow(left, right, &product))
     {
-        std::vector<std::size_t> intersection;
-        std::set_intersection(
-            card.winningNumbers.begin(),
-            card.winningNumbers.end(),
-            card.ticketNumbers.begin(),
-            card.ticketNumbers.end(),
-            std::back_inserter(intersection));
+        throw std::overflow_error("Card total overflows 64 bits");
+    }
+    return product;
+}
 
-        if (!intersection.empty())
+// Copies won by the cards seen so far. Each card adds its copies to the running count of won copies and schedules
+// them to expire after the last card it wins, so the count never goes through a negative difference and can be
+// overflow checked. A card wins copies of at most the next kMaxCardNumber cards, so the expiring copies are a fixed
+// size ring buffer and cards can be pushed while they are still being parsed.
+class CardCascade
+{
+public:
+    // Adds the next card, returns the number of its copies including the original
+    std::uint64_t push(std::size_t matches)
+    {
+        std::uint64_t copies = addChecked(1, mWonCopies);
+        mTotal               = addChecked(mTotal, copies);
+        if (matches != 0)
         {
-            score += 1 << (intersection.size() - 1);
+            // Every copy of this card wins one copy of each of the next matches cards
+            mWonCopies    = addChecked(mWonCopies, copies);
+            auto& expires = mExpiring[(mCard + matches) % mExpiring.size()];
+            expires       = addChecked(expires, copies);
         }
 
-        card.matches = intersection.size();
+        auto& expiring = mExpiring[mCard % mExpiring.size()];
+        mWonCopies -= expiring;
+        expiring = 0;
+        mCard++;
+        return copies;
     }
 
+    std::uint64_t total() const
+    {
+        return mTotal;
+    }
+
+private:
+    std::array<std::uint64_t, kMaxCardNumber + 1> mExpiring{};
+    std::uint64_t                                 mWonCopies = 0;
+    std::uint64_t                                 mTotal     = 0;
+    std::size_t                                   mCard      = 0;
+};
+
+std::uint64_t partOne(std::vector<Card> const& cards)
+{
+    std::uint64_t score = 0;
+    for (auto const& card : cards)
+    {
+        score = addChecked(score, cardPoints(card.matches));
+    }
     return score;
 }
 
-size_t partTwo(std::vector<Card>& cards)
+std::uint64_t partTwo(std::vector<Card>& cards)
 {
+    CardCascade cascade;
     for (auto& card : cards)
     {
-        if (card.matches != 0)
+        card.cardsCount = cascade.push(card.matches);
+    }
+    return cascade.total();
+}
+
+// Solves both parts without keeping the cards around
+std::pair<std::uint64_t, std::uint64_t> streamInput(std::istream& input)
+{
+    std::string   line;
+    std::uint64_t score = 0;
+    CardCascade cascade;
+    while (std::getline(input, line))
+    {
+        if (isCardLine(line))
+        {
+            auto matches = countMatches(line);
+            score = addChecked(score, cardPoints(matches));
+            cascade.push(matches);
+        }
+    }
+    return {score, cascade.total()};
+}
+
+// Effect of one block of cards on the cascade. Copies won by earlier cards only reach the first maxMatches cards
+// of the block, and are given as a carry vector. Block total and the carry into the next block are affine in the
+// incoming carry, so they are stored as a constant part plus one column per incoming carry entry. Every entry is
+// bounded by the copies a card's original spawns, which the answer includes, so all of it is overflow checked like
+// in CardCascade.
+struct CascadeBlock
+{
+    std::uint64_t              total = 0;
+    std::vector<std::uint64_t> carry;             // carry out for a zero carry in
+    std::vector<std::uint64_t> totalSensitivity;  // [k] total per copy carried into card k
+    std::vector<std::uint64_t> carrySensitivity;  // [k * maxMatches + j] carry out j per copy carried into card k
+};
+
+// Runs the cascade over the block for a single incoming extra copy of card start, or for no incoming copies when
+// originals is 1. Returns block total and writes the carry out. expiring holds the copies expiring after each card
+// of the block and the maxMatches cards past it, it has to be zeroed and is left zeroed.
+std::uint64_t runCascadeBlock(
+    std::vector<std::uint8_t> const& matches,
+    std::size_t                      start,
+    std::uint64_t                    originals,
+    std::vector<std::uint64_t>&      expiring,
+    std::uint64_t*                   carry)
+{
+    auto const cards      = matches.size();
+    auto const maxMatches = expiring.size() - cards - 1;
+
+    std::uint64_t total     = 0;
+    std::uint64_t wonCopies = 0;
+    // Last card which can have won copies, past it nothing changes anymore when there are no originals
+    std::size_t reach = start;
+    if (originals == 0)
+    {
+        wonCopies       = 1;
+        expiring[start] = 1;
+    }
+    else
+    {
+        reach = cards + maxMatches;
+    }
+
+    std::size_t card = start;
+    for (; (card < cards) && (card <= reach); card++)
+    {
+        std::uint64_t copies = addChecked(originals, wonCopies);
+        total                = addChecked(total, copies);
+        if ((matches[card] != 0) && (copies != 0))
+        {
+            auto& expires = expiring[card + matches[card]];
+            wonCopies     = addChecked(wonCopies, copies);
+            expires       = addChecked(expires, copies);
+            reach         = std::max(reach, card + matches[card]);
+        }
+        wonCopies -= expiring[card];
+        expiring[card] = 0;
+    }
+
+    // Past the reach nothing is won anymore, and everything scheduled to expire has already expired
+    for (std::size_t idx = 0; idx < maxMatches; idx++)
+    {
+        carry[idx] = wonCopies;
+        if (card == cards)
+        {
+            wonCopies -= expiring[cards + idx];
+            expiring[cards + idx] = 0;
+        }
+    }
+    return total;
+}
+
+CascadeBlock analyzeCascadeBlock(std::vector<std::uint8_t> const& matches, std::size_t maxMatches)
+{
+    CascadeBlock               block;
+    std::vector<std::uint64_t> expiring(matches.size() + maxMatches + 1, 0);
+
+    block.carry.resize(maxMatches);
+    block.total = runCascadeBlock(matches, 0, 1, expiring, block.carry.data());
+
+    block.totalSensitivity.resize(maxMatches);
+    block.carrySensitivity.resize(maxMatches * maxMatches);
+    for (std::size_t idx = 0; (idx < maxMatches) && (idx < matches.size()); idx++)
+    {
+        block.totalSensitivity[idx] =
+            runCascadeBlock(matches, idx, 0, expiring, block.carrySensitivity.data() + idx * maxMatches);
+    }
+    // Copies carried past a block shorter than maxMatches pass straight through to the next block
+    for (auto idx = matches.size(); idx < maxMatches; idx++)
+    {
+        block.carrySensitivity[idx * maxMatches + (idx - matches.size())] = 1;
+    }
+    return block;
+}
+
+// Parses and counts matches on newline aligned chunks in parallel, one per thread. Each chunk is then one block of
+// the cascade, analyzed in parallel as well, and the blocks are chained in order at the end.
+std::pair<std::uint64_t, std::uint64_t> solveParallel(std::string_view input, unsigned threadCount)
+{
+    std::vector<std::string_view> chunks;
+    std::size_t                   begin = 0;
+    for (unsigned idx = 1; idx <= threadCount; idx++)
+    {
+        std::size_t end = input.size() * idx / threadCount;
+        if (end < input.size())
+        {
+            end = input.find('\n', std::max(end, begin));
+            end = (end == std::string_view::npos) ? input.size() : end + 1;
+        }
+        if (end > begin)
+        {
+            chunks.push_back(input.substr(begin, end - begin));
+            begin = end;
+        }
+    }
+
+    std::vector<std::vector<std::uint8_t>> matches(chunks.size());
+    std::vector<std::uint64_t>             points(chunks.size(), 0);
+    std::vector<std::exception_ptr>        errors(chunks.size());
+    std::vector<std::thread>               workers;
+    for (std::size_t idx = 0; idx < chunks.size(); idx++)
+    {
+        workers.emplace_back([&chunks, &matches, &points, &errors, idx]() {
+            try
+            {
+                auto chunk = chunks[idx];
+                while (!chunk.empty())
+                {
+                    auto lineEnd = std::min(chunk.find('\n'), chunk.size());
+                    auto line    = chunk.substr(0, lineEnd);
+                    if (isCardLine(line))
+                    {
+                        auto cardMatches = countMatches(line);
+                        points[idx] = addChecked(points[idx], cardPoints(cardMatches));
+                        matches[idx].push_back(static_cast<std::uint8_t>(cardMatches));
+                    }
+                    chunk.remove_prefix(std::min(lineEnd + 1, chunk.size()));
+                }
+            }
+            catch (...)
+            {
+                // Rethrown on the calling thread once all workers are joined
+                errors[idx] = std::current_exception();
+            }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    workers.clear();
+    for (auto const& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+
+    std::uint64_t score      = 0;
+    std::size_t   maxMatches = 0;
+    for (std::size_t idx = 0; idx < chunks.size(); idx++)
+    {
+        score = addChecked(score, points[idx]);
+        for (auto cardMatches : matches[idx])
         {
-            // Increment the score for each card won by the times the current card was won until now.
-            for (size_t i = (card.cardNumber + 1); i <= ( card.cardNumber+ card.matches); i++)
+            maxMatches = std::max<std::size_t>(maxMatches, cardMatches);
+        }
+    }
+
+    std::vector<CascadeBlock> blocks(chunks.size());
+    for (std::size_t idx = 0; idx < chunks.size(); idx++)
+    {
+        workers.emplace_back([&blocks, &matches, &errors, maxMatches, idx]() {
+            try
+            {
+                blocks[idx] = analyzeCascadeBlock(matches[idx], maxMatches);
+            }
+            catch (...)
             {
-                cards[i].cardsCount += card.cardsCount;
+                errors[idx] = std::current_exception();
             }
+        });
+    }
+    for (auto& worker : workers)
+    {
+        worker.join();
+    }
+    for (auto const& error : errors)
+    {
+        if (error)
+        {
+            std::rethrow_exception(error);
         }
     }
 
-    std::size_t score = std::accumulate(cards.begin(), cards.end(), 0, [](std::size_t score, Card const& card){
-        return score + card.cardsCount;
-    });
-    return score;
+    std::uint64_t              total = 0;
+    std::vector<std::uint64_t> carry(maxMatches, 0);
+    std::vector<std::uint64_t> nextCarry(maxMatches);
+    for (auto const& block : blocks)
+    {
+        total     = addChecked(total, block.total);
+        nextCarry = block.carry;
+        for (std::size_t k = 0; k < maxMatches; k++)
+        {
+            total = addChecked(total, multiplyChecked(block.totalSensitivity[k], carry[k]));
+            for (std::size_t j = 0; j < maxMatches; j++)
+            {
+                auto const carried = multiplyChecked(block.carrySensitivity[k * maxMatches + j], carry[k]);
+                nextCarry[j]       = addChecked(nextCarry[j], carried);
+            }
+        }
+        std::swap(carry, nextCarry);
+    }
+    return {score, total};
 }
 
-int main()
+int main(int argc, char** argv)
 {
+    // Usage: day_04 [--stream [file] | --threads [count]], streaming mode reads stdin when no file or "-" is given
+    std::string_view mode = (argc > 1) ? argv[1] : "";
+    if (mode == "--threads")
+    {
+        std::ifstream      file("input.txt", std::ios::binary);
+        std::ostringstream buffer;
+        buffer << file.rdbuf();
+        auto const input = buffer.str();
+
+        unsigned threadCount = (argc > 2) ? std::stoul(argv[2]) : std::thread::hardware_concurrency();
+        auto     score       = solveParallel(input, std::max(threadCount, 1U));
+        std::cout << "First Part " << score.first << std::endl;
+        std::cout << "Second Part " << score.second << std::endl;
+        return 0;
+    }
+    if (mode == "--stream")
+    {
+        std::pair<std::uint64_t, std::uint64_t> score;
+        if ((argc > 2) && (std::string_view(argv[2]) != "-"))
+        {
+            std::ifstream input(argv[2]);
+            if (!input)
+            {
+                throw std::runtime_error("Unable to open " + std::string(argv[2]));
+            }
+            score = streamInput(input);
+        }
+        else
+        {
+            score = streamInput(std::cin);
+        }
+        std::cout << "First Part " << score.first << std::endl;
+        std::cout << "Second Part " << score.second << std::endl;
+        return 0;
+    }
+
     auto cards = loadInput();
     std::cout << "First Part " << partOne(cards) << std::endl;
     std::cout << "Second Part " << partTwo(cards) << std::endl;
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cinttypes>
+#include <vector>
+
+struct Mapping
+{
+    std::size_t dst;
+    std::size_t src;
+    std::size_t len;
+};
+
+using Mappings = std::vector<Mapping>;
+
+// Seeds and the chain of mapping stages which lead from a seed to its location, in the order they are applied
+struct Almanac
+{
+    std::vector<std::size_t> seeds;
+    std::vector<Mappings>    stages;
+};
@@ -1,24 +1,16 @@
 #include <vector>
 #include <cinttypes>
+#include "almanac.hpp"
 
 #if 0
-std::vector<std::size_t> seeds{79, 14, 55, 13};
+constexpr std::size_t seeds[]{79, 14, 55, 13};
 
-struct Mapping
-{
-    std::size_t dst;
-    std::size_t src;
-    std::size_t len;
-};
-
-using Mappings = std::vector<Mapping>;
-
-Mappings seedToSoil{
+constexpr Mapping seedToSoil[]{
 {50, 98, 2},
 {52 ,50, 48}
 };
 
-Mappings soilToFertilizer
+constexpr Mapping soilToFertilizer[]
 {
 {0,  15 ,37},
 {37, 52, 2},
@@ -26,48 +18,39 @@ Mappings soilToFertilizer
 };
 
 
-Mappings fertilizerToWater{
+constexpr Mapping fertilizerToWater[]{
 {49,53,8},
 {0,11,42},
 {42,0,7},
 {57,7,4}};
 
-Mappings waterToLight{
+constexpr Mapping waterToLight[]{
 {88,18,7},
 {18,25,70}};
 
-Mappings lightToTemperature
+constexpr Mapping lightToTemperature[]
 {
 {45,77,23},
 {81,45,19},
 {68,64,13}
 };
-Mappings temperatureToHumidity{
+constexpr Mapping temperatureToHumidity[]{
 {0,69,1},
 {1,0,69}
 };
 
-Mappings humidityToLocation{
+constexpr Mapping humidityToLocation[]{
 {60,56,37},
 {56,93,4}
 };
 
 #else
 
-std::vector<std::size_t> seeds{3136945476, 509728956,  1904897211, 495273540, 1186343315, 66026055,   1381149926,
-                               11379441,   4060485949, 190301545,  444541979, 351779229,  1076140984, 104902451,
-                               264807001,  60556152,   3676523418, 44140882,  3895155702, 111080695};
-
-struct Mapping
-{
-    std::size_t dst;
-    std::size_t src;
-    std::size_t len;
-};
-
-using Mappings = std::vector<Mapping>;
+constexpr std::size_t seeds[]{3136945476, 509728956,  1904897211, 495273540, 1186343315, 66026055,   1381149926,
+                              11379441,   4060485949, 190301545,  444541979, 351779229,  1076140984, 104902451,
+                              264807001,  60556152,   3676523418, 44140882,  3895155702, 111080695};
 
-Mappings seedToSoil{
+constexpr Mapping seedToSoil[]{
 {2122609492,2788703865,117293332},
 {751770532,1940296486,410787026},
 {2652142963,2905997197,464992562},
@@ -84,7 +67,7 @@ Mappings seedToSoil{
 {2639375948,1113622284,12767015}
 };
 
-Mappings soilToFertilizer
+constexpr Mapping soilToFertilizer[]
 {
 {1839905294,2992775329,34548650},
 {266781855,3027323979,163164353},
@@ -109,7 +92,7 @@ Mappings soilToFertilizer
 };
 
 
-Mappings fertilizerToWater{
+constexpr Mapping fertilizerToWater[]{
 {2408925737,4214441342,80525954},
 {1405678964,176700146,234310964},
 {2103148712,0,114754845},
@@ -154,7 +137,7 @@ Mappings fertilizerToWater{
 {179951542,551162782,109859700}
 };
 
-Mappings waterToLight{
+constexpr Mapping waterToLight[]{
 {2182426048,2230942562,75597875},
 {3871195410,3518497934,102047632},
 {2258023923,1068663414,38503018},
@@ -197,7 +180,7 @@ Mappings waterToLight{
 {293218005,301584645,185719101}
 };
 
-Mappings lightToTemperature
+constexpr Mapping lightToTemperature[]
 {
 {2047881931,2133163196,61773729},
 {2768352591,2658645540,147815435},
@@ -245,7 +228,7 @@ Mappings lightToTemperature
 {4210177194,2806460975,84790102}
 };
 
-Mappings temperatureToHumidity{
+constexpr Mapping temperatureToHumidity[]{
 {2704404081,3383155981,190240562},
 {3678765766,3078657339,304498642},
 {2894644643,2740175301,304339717},
@@ -255,7 +238,7 @@ Mappings temperatureToHumidity{
 {3411756539,3573396543,267009227}
 };
 
-Mappings humidityToLocation{
+constexpr Mapping humidityToLocation[]{
 {3843755612,3461421206,53203349},
 {3797023193,2837279508,46732419},
 {1328442859,1820435049,165058603},
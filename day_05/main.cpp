@@ -1,10 +1,161 @@
 #include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
 #include <cmath>
 #include <cstdlib>
 #include <iostream>
-#include <optional>
-#include <set>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// AVX2 gathers for the batched lookup, opt-in as the scalar lockstep loop is usually just as fast or faster
+#if defined(EYTZINGER_GATHER)
+#include <immintrin.h>
+#endif
+
+#include "almanac.hpp"
+
+// Almanac compiled in from input.hpp instead of parsed at runtime, both answers are then computed at compile time
+#ifdef EMBEDDED_ALMANAC
 #include "input.hpp"
+#endif
+
+// Read-only memory mapping of a whole file
+class MappedFile
+{
+public:
+    explicit MappedFile(char const* path)
+    {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error(std::string("Can't open ") + path);
+        }
+
+        struct stat status = {};
+        if ((::fstat(fd, &status) == 0) && (status.st_size > 0))
+        {
+            mSize = static_cast<std::size_t>(status.st_size);
+            mData = ::mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mData == MAP_FAILED)
+            {
+                ::close(fd);
+                throw std::runtime_error(std::string("Can't map ") + path);
+            }
+            ::madvise(mData, mSize, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (mSize != 0)
+        {
+            ::munmap(mData, mSize);
+        }
+    }
+
+    MappedFile(MappedFile const&)            = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    std::string_view view() const
+    {
+        return {static_cast<char const*>(mData), mSize};
+    }
+
+private:
+    void*       mData = nullptr;
+    std::size_t mSize = 0;
+};
+
+// Calls visit(number) for every unsigned number in line
+template <typename Visitor>
+void forEachNumber(std::string_view line, Visitor&& visit)
+{
+    char const* pos = line.data();
+    char const* end = line.data() + line.size();
+    while (pos != end)
+    {
+        if ((*pos < '0') || (*pos > '9'))
+        {
+            ++pos;
+            continue;
+        }
+        std::size_t number = 0;
+        auto        result = std::from_chars(pos, end, number);
+        if (result.ec != std::errc())
+        {
+            throw std::out_of_range("Almanac number out of range");
+        }
+        visit(number);
+        pos = result.ptr;
+    }
+}
+
+/**
+ * Parses the almanac text format:
+ *
+ * seeds: 79 14 55 13
+ *
+ * seed-to-soil map:
+ * 50 98 2
+ * 52 50 48
+ * ...
+ *
+ * Every "map:" header starts a new stage, any number of stages is supported and they are applied in the order they
+ * appear in the text.
+ */
+Almanac parseAlmanac(std::string_view text)
+{
+    Almanac almanac;
+    while (!text.empty())
+    {
+        auto lineEnd = std::min(text.find('\n'), text.size());
+        auto line    = text.substr(0, lineEnd);
+        text.remove_prefix(std::min(lineEnd + 1, text.size()));
+
+        if (line.substr(0, 6) == "seeds:")
+        {
+            forEachNumber(line, [&almanac](std::size_t seed) { almanac.seeds.push_back(seed); });
+        }
+        else if (line.find("map:") != std::string_view::npos)
+        {
+            almanac.stages.emplace_back();
+        }
+        else
+        {
+            std::array<std::size_t, 3> numbers{};
+            std::size_t                count = 0;
+            forEachNumber(line, [&numbers, &count](std::size_t number) {
+                if (count < numbers.size())
+                {
+                    numbers[count] = number;
+                }
+                count++;
+            });
+
+            if (count == 0)
+            {
+                continue;
+            }
+            if ((count != numbers.size()) || almanac.stages.empty())
+            {
+                throw std::runtime_error("Malformed almanac line: " + std::string(line));
+            }
+            almanac.stages.back().push_back(Mapping{numbers[0], numbers[1], numbers[2]});
+        }
+    }
+    return almanac;
+}
 
 size_t transform(std::size_t x, Mappings const& mappings)
 {
@@ -23,24 +174,6 @@ size_t transform(std::size_t x, Mappings const& mappings)
     return x;
 }
 
-size_t partOne()
-{
-    std::set<std::size_t> locations;
-
-    for (auto seed : seeds)
-    {
-        auto soil        = transform(seed, seedToSoil);
-        auto fertilizer  = transform(soil, soilToFertilizer);
-        auto water       = transform(fertilizer, fertilizerToWater);
-        auto light       = transform(water, waterToLight);
-        auto temperature = transform(light, lightToTemperature);
-        auto humidity    = transform(temperature, temperatureToHumidity);
-        auto location    = transform(humidity, humidityToLocation);
-        locations.insert(location);
-    }
-    return *locations.begin();
-}
-
 struct Range
 {
     Range(std::size_t begin, std::size_t end)
@@ -68,121 +201,547 @@ struct Range
     }
 };
 
-// Check if left range intersects with right range
-std::optional<Range> intersection(Range const& left, Range const& right)
+// Piece of a piecewise linear map, x in [begin, begin of the next segment) maps to dst + (x - begin)
+struct Segment
 {
-    if (left.begin <= right.begin && right.begin < left.end)
+    std::size_t begin;
+    std::size_t dst;
+};
+
+// Fixed capacity segment storage, lets piecewise maps be built in constant expressions
+template <std::size_t Capacity>
+struct StaticSegments
+{
+    constexpr std::size_t size() const
+    {
+        return count;
+    }
+
+    constexpr bool empty() const
+    {
+        return count == 0;
+    }
+
+    constexpr Segment& operator[](std::size_t idx)
+    {
+        return items[idx];
+    }
+
+    constexpr Segment const& operator[](std::size_t idx) const
     {
-        // left range is either super set of right or they have a part intersection
-        if (left.end <= right.end)
+        return items[idx];
+    }
+
+    constexpr Segment& back()
+    {
+        return items[count - 1];
+    }
+
+    constexpr void push_back(Segment const& segment)
+    {
+        if (count == Capacity)
         {
-            return Range{right.begin, left.end};
+            throw std::length_error("StaticSegments capacity exceeded");
         }
-        return right;
+        items[count++] = segment;
     }
 
-    if (right.begin <= left.begin && left.begin < right.end)
+    std::array<Segment, Capacity> items{};
+    std::size_t                   count = 0;
+};
+
+// Map from [0, kDomainEnd) onto itself as sorted, gapless segments. The first segment always begins at 0, so any x
+// is inside the last segment beginning at or before it. Storage is std::vector<Segment> at runtime and
+// StaticSegments for maps evaluated at compile time.
+template <typename Storage>
+struct BasicPiecewiseMap
+{
+    static constexpr std::size_t kDomainEnd = std::numeric_limits<std::size_t>::max();
+
+    // Index of the segment containing x
+    constexpr std::size_t find(std::size_t x) const
     {
-        // right range is either superset of left they have a par intersection
-        if (right.end <= left.end)
+        std::size_t low  = 0;
+        std::size_t high = segments.size();
+        while ((high - low) > 1)
         {
-            return Range{left.begin, right.end};
+            auto middle = low + (high - low) / 2;
+            if (segments[middle].begin <= x)
+            {
+                low = middle;
+            }
+            else
+            {
+                high = middle;
+            }
         }
-        return left;
+        return low;
     }
 
-    return {};
+    constexpr std::size_t segmentEnd(std::size_t idx) const
+    {
+        return ((idx + 1) < segments.size()) ? segments[idx + 1].begin : kDomainEnd;
+    }
+
+    constexpr std::size_t operator()(std::size_t x) const
+    {
+        auto const& segment = segments[find(x)];
+        return segment.dst + (x - segment.begin);
+    }
+
+    // Appends a segment, merging it into the previous one when it continues the same linear piece
+    constexpr void append(Segment const& segment)
+    {
+        if (!segments.empty())
+        {
+            auto const& last = segments.back();
+            if (segment.begin == last.begin)
+            {
+                segments.back() = segment;
+                return;
+            }
+            if ((last.dst + (segment.begin - last.begin)) == segment.dst)
+            {
+                return;
+            }
+        }
+        segments.push_back(segment);
+    }
+
+    Storage segments;
+};
+
+using PiecewiseMap = BasicPiecewiseMap<std::vector<Segment>>;
+
+// Stage from mappings sorted by source as a piecewise map, values outside of all mappings map to themselves.
+// Mappings are expected not to overlap, otherwise the one with the lower source wins for the overlapping part.
+template <typename Map, typename Iterator>
+constexpr Map fromSortedMappings(Iterator mapping, Iterator end)
+{
+    Map         map{};
+    std::size_t covered = 0;
+    for (; mapping != end; ++mapping)
+    {
+        auto const srcEnd = mapping->src + mapping->len;
+        if (srcEnd <= covered)
+        {
+            continue;
+        }
+        if (mapping->src > covered)
+        {
+            map.append(Segment{covered, covered});
+        }
+        auto const begin = std::max(mapping->src, covered);
+        map.append(Segment{begin, mapping->dst + (begin - mapping->src)});
+        covered = srcEnd;
+    }
+    if (map.segments.empty() || (covered < Map::kDomainEnd))
+    {
+        map.append(Segment{covered, covered});
+    }
+    return map;
 }
 
-using Ranges         = std::vector<Range>;
-using OptionalRanges = std::vector<std::optional<Range>>;
-using OrderedRanges  = std::set<Range>;
+PiecewiseMap toPiecewiseMap(Mappings stage)
+{
+    std::sort(stage.begin(), stage.end(), [](Mapping const& left, Mapping const& right) {
+        return left.src < right.src;
+    });
+    return fromSortedMappings<PiecewiseMap>(stage.begin(), stage.end());
+}
 
-OrderedRanges transformRange(Range const& srcRange, Mapping const& mapping)
+// Sweep line over ranges sorted by begin against the segments of map. Calls visit(rangeIdx, piece, segment) for
+// every part of a range which falls into a single segment, identity segments included, so no part of a range is
+// dropped. The segment holding the begin of the next range is only ever searched forward, which makes a sweep
+// O(ranges + segments + pieces).
+template <typename Visitor>
+void sweepRanges(std::vector<Range> const& ranges, PiecewiseMap const& map, Visitor&& visit)
 {
-    OrderedRanges mappedRange;
-    auto          section = intersection(srcRange, Range{mapping.src, mapping.src + mapping.len});
-    if (section)
+    std::size_t first = 0;
+    for (std::size_t rangeIdx = 0; rangeIdx < ranges.size(); rangeIdx++)
     {
-        // input range intersects with mapping source range
-        // do the mapping on intersection
-        std::size_t offset = section->begin - mapping.src;  // intersection always start either at src or past it.
-        mappedRange.insert(Range(mapping.dst + offset, mapping.dst + offset + section->size()));
+        auto const& range = ranges[rangeIdx];
+        while (((first + 1) < map.segments.size()) && (map.segmentEnd(first) <= range.begin))
+        {
+            first++;
+        }
+        for (auto idx = first, begin = range.begin; begin < range.end; idx++)
+        {
+            auto end = std::min(range.end, map.segmentEnd(idx));
+            visit(rangeIdx, Range{begin, end}, map.segments[idx]);
+            begin = end;
+        }
+    }
+}
 
-        //? Also include unmapped parts of the range.
-        //! I still think this is necessary to get the general solution, but I got the correct solution for my input without it.
-        //! Including non-mapped parts of range causes additional problems when the same initial range is affected by multiple mappings.
-        // Range before{srcRange.begin, section->begin};
-        // if (!before.empty())
-        // {
-        //     mappedRange.insert(before);
-        // }
+// second(first(x)) as a single map. The image of each segment of first is walked through the segments of second
+// it overlaps, every overlap becomes a segment of the composed map. Segments of first are taken in order, so the
+// pieces come out sorted and the walk works in constant expressions as well.
+template <typename Storage>
+constexpr BasicPiecewiseMap<Storage> compose(BasicPiecewiseMap<Storage> const& first,
+                                             BasicPiecewiseMap<Storage> const& second)
+{
+    BasicPiecewiseMap<Storage> composed{};
+    for (std::size_t idx = 0; idx < first.segments.size(); idx++)
+    {
+        auto const& segment  = first.segments[idx];
+        auto const  length   = first.segmentEnd(idx) - segment.begin;
+        auto const  imageEnd = (segment.dst + length < segment.dst) ? first.kDomainEnd : segment.dst + length;
 
-        // Range after{section->end, srcRange.end};
-        // if (!after.empty())
-        // {
-        //     mappedRange.insert(after);
-        // }
+        for (auto image = segment.dst, secondIdx = second.find(image); image < imageEnd; secondIdx++)
+        {
+            auto const& secondSegment = second.segments[secondIdx];
+            composed.append(Segment{
+                segment.begin + (image - segment.dst), secondSegment.dst + (image - secondSegment.begin)});
+            image = second.segmentEnd(secondIdx);
+        }
+    }
+    return composed;
+}
+
+// Whole chain of stages from seed to location as a single map
+PiecewiseMap composeStages(std::vector<Mappings> const& stages)
+{
+    PiecewiseMap composed{{Segment{0, 0}}};
+    for (auto const& stage : stages)
+    {
+        composed = compose(composed, toPiecewiseMap(stage));
     }
-    return mappedRange;
+    return composed;
 }
 
-OrderedRanges transformRangesForMapping(OrderedRanges const& ranges, Mappings const& mappings)
+// Segment begins of a map in Eytzinger (breadth first) order for branchless lookups. Slot k has children 2k and
+// 2k + 1, slot 0 is unused. Each slot holds the begin of a segment, but the begin and dst of the segment before it,
+// so descending to the first begin greater than x lands directly on the data of the segment containing x. Begins
+// are padded with kDomainEnd to a full tree, so every lookup runs the same number of levels and always ends on a
+// slot, because x is below the padding.
+class EytzingerMap
 {
-    OrderedRanges transformedRanges;
-    for (auto const& range : ranges)
+public:
+    explicit EytzingerMap(PiecewiseMap const& map)
     {
-        OrderedRanges outputRanges;
-        for (auto const& mapping : mappings)
+        std::size_t slots = 1;
+        for (mLevels = 0; slots < (map.segments.size() + 2); mLevels++)
         {
-            auto mappedRanges = transformRange(range, mapping);
-            outputRanges.insert(mappedRanges.begin(), mappedRanges.end());
+            slots *= 2;
         }
-        if (outputRanges.empty())
+        mKeys.resize(slots, PiecewiseMap::kDomainEnd);
+        mBegins.resize(slots, map.segments.back().begin);
+        mDsts.resize(slots, map.segments.back().dst);
+
+        // Sorted index 0 is the first segment, it never gets looked up as it begins at 0
+        std::size_t sortedIdx = 0;
+        fill(map, 1, sortedIdx);
+    }
+
+    std::size_t operator()(std::size_t x) const
+    {
+        auto slot = descend(x);
+        return mDsts[slot] + (x - mBegins[slot]);
+    }
+
+    // Looks up kBatch values in lockstep, so the loads of independent lookups overlap
+    void transform(std::size_t const* in, std::size_t* out, std::size_t count) const
+    {
+        std::size_t idx = 0;
+        for (; (idx + kBatch) <= count; idx += kBatch)
+        {
+            std::array<std::size_t, kBatch> slots;
+            descendBatch(in + idx, slots.data());
+            for (std::size_t lane = 0; lane < kBatch; lane++)
+            {
+                out[idx + lane] = mDsts[slots[lane]] + (in[idx + lane] - mBegins[slots[lane]]);
+            }
+        }
+        for (; idx < count; idx++)
         {
-            // no mapping took place, output range is equal to input range
-            outputRanges.insert(range);
+            out[idx] = (*this)(in[idx]);
         }
+    }
+
+private:
+    static constexpr std::size_t kBatch = 16;
 
-        transformedRanges.insert(outputRanges.begin(), outputRanges.end());
+    void fill(PiecewiseMap const& map, std::size_t slot, std::size_t& sortedIdx)
+    {
+        if (slot >= mKeys.size())
+        {
+            return;
+        }
+        fill(map, 2 * slot, sortedIdx);
+        if (sortedIdx < map.segments.size())
+        {
+            mKeys[slot] = map.segments[sortedIdx].begin;
+            if (sortedIdx > 0)
+            {
+                mBegins[slot] = map.segments[sortedIdx - 1].begin;
+                mDsts[slot]   = map.segments[sortedIdx - 1].dst;
+            }
+        }
+        sortedIdx++;
+        fill(map, 2 * slot + 1, sortedIdx);
     }
-    return transformedRanges;
+
+    // Slot of the first key greater than x
+    std::size_t descend(std::size_t x) const
+    {
+        std::size_t slot = 1;
+        for (std::size_t level = 0; level < mLevels; level++)
+        {
+            slot = 2 * slot + (mKeys[slot] <= x);
+        }
+        // Undo the trailing right turns and the final left turn
+        return slot >> (__builtin_ctzll(~slot) + 1);
+    }
+
+    void descendBatch(std::size_t const* x, std::size_t* slots) const
+    {
+#if defined(EYTZINGER_GATHER)
+        // Unsigned compare as signed compare of values with a flipped sign bit
+        auto const signBit = _mm256_set1_epi64x(std::numeric_limits<std::int64_t>::min());
+        auto const one     = _mm256_set1_epi64x(1);
+        constexpr std::size_t kVectors = kBatch / 4;
+        __m256i               values[kVectors];
+        __m256i               current[kVectors];
+        for (std::size_t vector = 0; vector < kVectors; vector++)
+        {
+            values[vector] = _mm256_xor_si256(
+                _mm256_loadu_si256(reinterpret_cast<__m256i const*>(x + 4 * vector)), signBit);
+            current[vector] = one;
+        }
+        auto const* keys = reinterpret_cast<long long const*>(mKeys.data());
+        for (std::size_t level = 0; level < mLevels; level++)
+        {
+            for (std::size_t vector = 0; vector < kVectors; vector++)
+            {
+                auto key     = _mm256_xor_si256(_mm256_i64gather_epi64(keys, current[vector], 8), signBit);
+                auto greater = _mm256_cmpgt_epi64(key, values[vector]);  // -1 where the key is greater than x
+                current[vector] =
+                    _mm256_add_epi64(_mm256_add_epi64(_mm256_slli_epi64(current[vector], 1), one), greater);
+            }
+        }
+        for (std::size_t vector = 0; vector < kVectors; vector++)
+        {
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(slots + 4 * vector), current[vector]);
+        }
+#else
+        std::fill(slots, slots + kBatch, 1);
+        for (std::size_t level = 0; level < mLevels; level++)
+        {
+            for (std::size_t lane = 0; lane < kBatch; lane++)
+            {
+                slots[lane] = 2 * slots[lane] + (mKeys[slots[lane]] <= x[lane]);
+            }
+        }
+#endif
+        for (std::size_t lane = 0; lane < kBatch; lane++)
+        {
+            slots[lane] >>= __builtin_ctzll(~slots[lane]) + 1;
+        }
+    }
+
+    std::size_t              mLevels = 0;
+    std::vector<std::size_t> mKeys;
+    std::vector<std::size_t> mBegins;
+    std::vector<std::size_t> mDsts;
+};
+
+size_t partOne(Almanac const& almanac, PiecewiseMap const& seedToLocation)
+{
+    std::vector<std::size_t> locations(almanac.seeds.size());
+    EytzingerMap(seedToLocation).transform(almanac.seeds.data(), locations.data(), locations.size());
+    return locations.empty() ? 0 : *std::min_element(locations.begin(), locations.end());
 }
 
-size_t partTwo()
+size_t partTwo(Almanac const& almanac, PiecewiseMap const& seedToLocation)
 {
-    std::set<std::size_t> locations;
+    std::vector<Range> seedRanges;
+    for (std::size_t idx = 0; (idx + 1) < almanac.seeds.size(); idx += 2)
+    {
+        seedRanges.emplace_back(almanac.seeds[idx], almanac.seeds[idx] + almanac.seeds[idx + 1]);
+    }
+    std::sort(seedRanges.begin(), seedRanges.end());
 
-    OrderedRanges seedRanges;
+    // Every segment is increasing, so the lowest location of a piece is the one of its begin
+    std::size_t lowestLocation = std::numeric_limits<std::size_t>::max();
+    sweepRanges(seedRanges, seedToLocation, [&lowestLocation](std::size_t, Range const& piece, Segment const& segment) {
+        lowestLocation = std::min(lowestLocation, segment.dst + (piece.begin - segment.begin));
+    });
+    return lowestLocation;
+}
 
-    for (auto seedItr = seeds.begin(); seedItr != seeds.end();)
+#ifdef EMBEDDED_ALMANAC
+// Compile time maps of the compiled in almanac
+using StaticPiecewiseMap = BasicPiecewiseMap<StaticSegments<2048>>;
+
+template <std::size_t N>
+constexpr StaticPiecewiseMap toStaticPiecewiseMap(Mapping const (&stage)[N])
+{
+    // Insertion sort by source, std::sort isn't constexpr in C++17
+    std::array<Mapping, N> sorted{};
+    for (std::size_t idx = 0; idx < N; idx++)
     {
-    size_t seedBegin = *seedItr;
-    seedItr++;
-    size_t seedEnd = seedBegin + *seedItr;
-    seedItr++;
+        auto position = idx;
+        for (; (position > 0) && (sorted[position - 1].src > stage[idx].src); position--)
+        {
+            sorted[position] = sorted[position - 1];
+        }
+        sorted[position] = stage[idx];
+    }
+    return fromSortedMappings<StaticPiecewiseMap>(sorted.begin(), sorted.end());
+}
 
-    seedRanges.emplace(seedBegin, seedEnd);
+constexpr StaticPiecewiseMap kSeedToLocation = compose(
+    compose(
+        compose(
+            compose(
+                compose(
+                    compose(toStaticPiecewiseMap(seedToSoil), toStaticPiecewiseMap(soilToFertilizer)),
+                    toStaticPiecewiseMap(fertilizerToWater)),
+                toStaticPiecewiseMap(waterToLight)),
+            toStaticPiecewiseMap(lightToTemperature)),
+        toStaticPiecewiseMap(temperatureToHumidity)),
+    toStaticPiecewiseMap(humidityToLocation));
+
+constexpr bool isSortedFromZero(StaticPiecewiseMap const& map)
+{
+    for (std::size_t idx = 1; idx < map.segments.size(); idx++)
+    {
+        if (map.segments[idx - 1].begin >= map.segments[idx].begin)
+        {
+            return false;
+        }
+    }
+    return !map.segments.empty() && (map.segments[0].begin == 0);
+}
+static_assert(isSortedFromZero(kSeedToLocation), "Composed almanac has to be sorted and start at 0");
+
+constexpr std::size_t kPartOne = []() {
+    std::size_t lowestLocation = PiecewiseMap::kDomainEnd;
+    for (auto seed : seeds)
+    {
+        lowestLocation = std::min(lowestLocation, kSeedToLocation(seed));
+    }
+    return lowestLocation;
+}();
+
+constexpr std::size_t kPartTwo = []() {
+    std::size_t lowestLocation = PiecewiseMap::kDomainEnd;
+    for (std::size_t idx = 0; (idx + 1) < std::size(seeds); idx += 2)
+    {
+        auto const begin = seeds[idx];
+        auto const end   = seeds[idx] + seeds[idx + 1];
+        for (auto segment = kSeedToLocation.find(begin);
+             (segment < kSeedToLocation.segments.size()) && (kSeedToLocation.segments[segment].begin < end);
+             segment++)
+        {
+            auto const seed = std::max(kSeedToLocation.segments[segment].begin, begin);
+            lowestLocation  = std::min(lowestLocation, kSeedToLocation(seed));
+        }
     }
+    return lowestLocation;
+}();
 
-    // seedRanges.emplace(seeds[0], seeds[0] + seeds[1]);
+template <std::size_t N>
+Mappings toMappings(Mapping const (&stage)[N])
+{
+    return Mappings(std::begin(stage), std::end(stage));
+}
+#endif
+
+template <typename Function>
+double measureSeconds(Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Seeds per second through each stage, linear transform() against the Eytzinger lookup
+void benchmark(Almanac const& almanac, std::size_t seedCount)
+{
+    std::mt19937_64          random(2023);
+    std::vector<std::size_t> seeds(seedCount);
+    std::vector<std::size_t> linear(seedCount);
+    std::vector<std::size_t> eytzinger(seedCount);
 
-    auto soilRanges        = transformRangesForMapping(seedRanges, seedToSoil);
-    auto fertilizerRanges  = transformRangesForMapping(soilRanges, soilToFertilizer);
-    auto waterRanges       = transformRangesForMapping(fertilizerRanges, fertilizerToWater);
-    auto lightRanges       = transformRangesForMapping(waterRanges, waterToLight);
-    auto temperatureRanges = transformRangesForMapping(lightRanges, lightToTemperature);
-    auto humidityRanges    = transformRangesForMapping(temperatureRanges, temperatureToHumidity);
-    auto locationRanges    = transformRangesForMapping(humidityRanges, humidityToLocation);
+    for (std::size_t stageIdx = 0; stageIdx < almanac.stages.size(); stageIdx++)
+    {
+        auto const& stage = almanac.stages[stageIdx];
+
+        // Seeds spread over the mapped sources and a bit past them
+        std::size_t srcEnd = 1;
+        for (auto const& mapping : stage)
+        {
+            srcEnd = std::max(srcEnd, mapping.src + mapping.len);
+        }
+        std::uniform_int_distribution<std::size_t> distribution(0, srcEnd + srcEnd / 8);
+        for (auto& seed : seeds)
+        {
+            seed = distribution(random);
+        }
 
-    // std::set is always ordered in ascending order.
-    return locationRanges.begin()->begin;
+        double linearTime = measureSeconds([&]() {
+            for (std::size_t idx = 0; idx < seedCount; idx++)
+            {
+                linear[idx] = transform(seeds[idx], stage);
+            }
+        });
+        EytzingerMap lookup(toPiecewiseMap(stage));
+        double       eytzingerTime = measureSeconds([&]() {
+            lookup.transform(seeds.data(), eytzinger.data(), seedCount);
+        });
 
+        std::cout << "stage " << stageIdx << " (" << stage.size() << " mappings): transform "
+                  << seedCount / linearTime / 1e6 << " Mseeds/s, eytzinger " << seedCount / eytzingerTime / 1e6
+                  << " Mseeds/s" << ((linear == eytzinger) ? "" : " MISMATCH") << std::endl;
+    }
 }
 
-int main()
+int main(int argc, char** argv)
 {
-    std::cout << "First part " << partOne() << std::endl;
-    std::cout << "Second part " << partTwo() << std::endl;
+    // Usage: day_05 [almanac file] [--bench [seeds]], the file defaults to input.txt and is ignored when the almanac
+    // is compiled in
+    int                          arg  = 1;
+    [[maybe_unused]] char const* path = "input.txt";
+    if ((argc > arg) && (std::string_view(argv[arg]).substr(0, 2) != "--"))
+    {
+        path = argv[arg++];
+    }
+    bool const bench = (argc > arg) && (std::string_view(argv[arg]) == "--bench");
+
+#ifdef EMBEDDED_ALMANAC
+    if (!bench)
+    {
+        // Both answers were computed by the compiler
+        std::cout << "First part " << kPartOne << std::endl;
+        std::cout << "Second part " << kPartTwo << std::endl;
+        return 0;
+    }
+
+    Almanac const almanac{
+        {std::begin(seeds), std::end(seeds)},
+        {toMappings(seedToSoil),
+         toMappings(soilToFertilizer),
+         toMappings(fertilizerToWater),
+         toMappings(waterToLight),
+         toMappings(lightToTemperature),
+         toMappings(temperatureToHumidity),
+         toMappings(humidityToLocation)}};
+#else
+    MappedFile    file(path);
+    Almanac const almanac = parseAlmanac(file.view());
+#endif
+
+    if (bench)
+    {
+        benchmark(almanac, (argc > (arg + 1)) ? std::stoul(argv[arg + 1]) : (1 << 22));
+        return 0;
+    }
+
+    auto const seedToLocation = composeStages(almanac.stages);
+    std::cout << "First part " << partOne(almanac, seedToLocation) << std::endl;
+    std::cout << "Second part " << partTwo(almanac, seedToLocation) << std::endl;
     return 0;
-}
\ No newline at end of file
+}
@@ -1,8 +1,21 @@
 #include <algorithm>
+#include <array>
+#include <chrono>
 #include <cinttypes>
 #include <cmath>
+#include <cctype>
 #include <cstdlib>
+#include <fstream>
 #include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 struct RaceParams
 {
@@ -29,6 +42,8 @@ struct RaceParams
  * Solving for zero points we get the limits of the time_traveling and winning traveling times are between them
  */
 
+// Original floating point solver, kept as the benchmark baseline. The discriminant is squared in int64_t and rounded
+// to double, so the bounds are not exact for large races.
 std::pair<int64_t, int64_t> quadraticZeroPoints(int64_t a, int64_t b, int64_t c)
 {
     auto factor = std::sqrt(b * b - 4 * a * c);
@@ -53,28 +68,296 @@ std::pair<int64_t, int64_t> quadraticZeroPoints(int64_t a, int64_t b, int64_t c)
     return {first_int, second_int};
 }
 
+using uint128_t = unsigned __int128;
+using int128_t  = __int128;
+
+// Floor of the square root from an estimate. Estimates a few units off are settled with multiplications only, others
+// fall back to integer Newton steps: the first lands on or above the root for any positive estimate, after which the
+// iteration decreases monotonically onto it.
+uint64_t integerSqrt(uint128_t n, uint64_t estimate)
+{
+    uint128_t root = estimate;
+    for (int step = 0; step < 4; step++)
+    {
+        if ((root * root) > n)
+        {
+            --root;
+        }
+        else if (((root + 1) * (root + 1)) <= n)
+        {
+            ++root;
+        }
+        else
+        {
+            return static_cast<uint64_t>(root);
+        }
+    }
+
+    root = std::max<uint128_t>(root, 1);
+    root = (root + n / root) / 2;
+    while (true)
+    {
+        uint128_t next = (root + n / root) / 2;
+        if (next >= root)
+        {
+            return static_cast<uint64_t>(root);
+        }
+        root = next;
+    }
+}
+
+// Exact count of the winning hold times given an estimate of the root of time^2 - 4 * distance.
+// Holding h wins when (time - 2h)^2 < discriminant, so with m the largest integer whose square is below the
+// discriminant the wins are the h with |time - 2h| <= m, which is m + 1 values when time - m is even and m otherwise.
+uint64_t countWinningHolds(RaceParams const& race, uint64_t rootEstimate)
+{
+    int128_t const discriminant = int128_t(race.time) * race.time - int128_t(4) * race.distance;
+    if (discriminant <= 0)
+    {
+        return 0;
+    }
+    uint64_t root    = integerSqrt(static_cast<uint128_t>(discriminant), rootEstimate);
+    uint64_t largest = root - (uint128_t(root) * root == static_cast<uint128_t>(discriminant));
+    return largest + 1 - ((static_cast<uint64_t>(race.time) ^ largest) & 1);
+}
+
+double rootEstimate(RaceParams const& race)
+{
+    double time = race.time;
+    return std::sqrt(std::max(time * time - 4.0 * race.distance, 0.0));
+}
+
 size_t findWiningSituations(RaceParams const& input)
 {
-    auto winningRange = quadraticZeroPoints(1, -1 * input.time, input.distance);
-    return winningRange.second - winningRange.first + 1;
+    return countWinningHolds(input, static_cast<uint64_t>(rootEstimate(input)));
 }
 
-int main()
+#if defined(__SSE2__)
+// Non-negative int64_t lanes to double. There is no packed conversion below AVX-512, so each 32 bit half is placed in
+// the mantissa of 2^52 and the offset subtracted again.
+inline __m128d toDouble(__m128i value)
 {
-    // std::vector<RaceParams> input{{7, 9}, {15, 40}, {30, 200}}; // sample input
-    std::vector<RaceParams> input{{40,215}, {70,1051}, {98, 2147}, {79, 1005}};
+    auto const magic  = _mm_set1_epi64x(0x4330000000000000);
+    auto const offset = _mm_set1_pd(4503599627370496.0);
+    auto const high   = _mm_sub_pd(_mm_castsi128_pd(_mm_or_si128(_mm_srli_epi64(value, 32), magic)), offset);
+    auto const low    = _mm_sub_pd(
+        _mm_castsi128_pd(_mm_or_si128(_mm_and_si128(value, _mm_set1_epi64x(0xFFFFFFFF)), magic)), offset);
+    return _mm_add_pd(_mm_mul_pd(high, _mm_set1_pd(4294967296.0)), low);
+}
+#endif
 
-    size_t partOne = 1;
-    for (auto const& raceParam : input)
+// Root estimates of a batch of races, two races per SSE2 vector
+void rootEstimates(RaceParams const* races, double* estimates, size_t count)
+{
+    size_t idx = 0;
+#if defined(__SSE2__)
+    static_assert(sizeof(RaceParams) == sizeof(__m128i), "Races are loaded as one vector each");
+    for (; (idx + 2) <= count; idx += 2)
+    {
+        auto first        = _mm_loadu_si128(reinterpret_cast<__m128i const*>(races + idx));
+        auto second       = _mm_loadu_si128(reinterpret_cast<__m128i const*>(races + idx + 1));
+        auto time         = toDouble(_mm_unpacklo_epi64(first, second));
+        auto distance     = toDouble(_mm_unpackhi_epi64(first, second));
+        auto discriminant = _mm_sub_pd(_mm_mul_pd(time, time), _mm_mul_pd(_mm_set1_pd(4.0), distance));
+        _mm_storeu_pd(estimates + idx, _mm_sqrt_pd(_mm_max_pd(discriminant, _mm_setzero_pd())));
+    }
+#endif
+    for (; idx < count; idx++)
     {
-        partOne *= findWiningSituations(raceParam);
+        estimates[idx] = rootEstimate(races[idx]);
     }
+}
 
-    // RaceParams partTwoInput{71530, 940200}; // sample input
-    RaceParams partTwoInput{40709879, 215105121471005};
+// Batched evaluation, counts[idx] receives the number of winning holds for races[idx]. Races go in batches, the
+// floating point estimates of a batch are computed in one vectorized pass and the exact integer correction follows
+// per race.
+void findWiningSituations(RaceParams const* races, uint64_t* counts, size_t count)
+{
+    constexpr size_t           kBatch = 256;
+    std::array<double, kBatch> estimates;
+    for (size_t begin = 0; begin < count; begin += kBatch)
+    {
+        auto const batch = std::min(kBatch, count - begin);
+        rootEstimates(races + begin, estimates.data(), batch);
+        for (size_t idx = 0; idx < batch; idx++)
+        {
+            counts[begin + idx] = countWinningHolds(races[begin + idx], static_cast<uint64_t>(estimates[idx]));
+        }
+    }
+}
 
-    std::cout << "Part one: " << partOne << std::endl;
-    std::cout << "Part two: " << findWiningSituations(partTwoInput) << std::endl;
+struct RaceSheet
+{
+    std::vector<RaceParams> races;
+    RaceParams              combined; // All the digits of a row concatenated, the single race of part two
+};
+
+// Appends a digit to a value, throws once it no longer fits the race parameters
+int64_t appendDigit(uint128_t value, char digit)
+{
+    value = value * 10 + (digit - '0');
+    if (value > static_cast<uint128_t>(INT64_MAX))
+    {
+        throw std::overflow_error("Race value does not fit into 64 bits");
+    }
+    return static_cast<int64_t>(value);
+}
+
+// Numbers of a "Label: n n n" row, along with their concatenation
+std::vector<int64_t> parseRow(std::string_view line, std::string_view label, int64_t& combined)
+{
+    if (line.substr(0, label.size()) != label)
+    {
+        throw std::runtime_error("Expected row " + std::string(label));
+    }
 
+    std::vector<int64_t> numbers;
+    bool                 inNumber = false;
+    combined                      = 0;
+    for (char c : line.substr(label.size()))
+    {
+        if (std::isdigit(static_cast<unsigned char>(c)))
+        {
+            if (!inNumber)
+            {
+                numbers.push_back(0);
+            }
+            numbers.back() = appendDigit(numbers.back(), c);
+            combined       = appendDigit(combined, c);
+            inNumber       = true;
+        }
+        else
+        {
+            inNumber = false;
+        }
+    }
+    return numbers;
+}
+
+RaceSheet parseRaceSheet(std::istream& input)
+{
+    std::string timeLine;
+    std::string distanceLine;
+    std::getline(input, timeLine);
+    std::getline(input, distanceLine);
+
+    RaceSheet sheet;
+    auto      times     = parseRow(timeLine, "Time:", sheet.combined.time);
+    auto      distances = parseRow(distanceLine, "Distance:", sheet.combined.distance);
+    if (times.size() != distances.size())
+    {
+        throw std::runtime_error("Time and distance rows differ in length");
+    }
+
+    for (size_t idx = 0; idx < times.size(); idx++)
+    {
+        sheet.races.push_back(RaceParams{times[idx], distances[idx]});
+    }
+    return sheet;
+}
+
+template <typename Function>
+double measureSeconds(Function&& function)
+{
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+// Races per second with the original solver, the exact one per race and the batched exact one. Times go from part
+// two size up to where time^2 still fits int64_t, as the original solver overflows past it. Every other race has a
+// discriminant at or just above a perfect square, where rounding in the original solver shows.
+void benchmark(size_t raceCount)
+{
+    std::mt19937_64                         random(2023);
+    std::uniform_int_distribution<int64_t> times(10000000, 3000000000);
+    std::vector<RaceParams>                 races(raceCount);
+    for (size_t idx = 0; idx < raceCount; idx++)
+    {
+        auto& race = races[idx];
+        race.time  = times(random);
+        if ((idx % 2) == 0)
+        {
+            race.distance = std::uniform_int_distribution<int64_t>(0, race.time * race.time / 4)(random);
+        }
+        else
+        {
+            // time^2 - 4 * distance is root^2, or root^2 + 4 for a distance one lower, which rounds to the same
+            // double once time^2 passes 2^53
+            auto root     = std::uniform_int_distribution<int64_t>(0, race.time / 2 - 1)(random) * 2 + (race.time % 2);
+            race.distance = (race.time * race.time - root * root) / 4 - static_cast<int64_t>(random() % 2);
+        }
+    }
+
+    std::vector<uint64_t> legacy(raceCount);
+    std::vector<uint64_t> single(raceCount);
+    std::vector<uint64_t> batched(raceCount);
+    double                legacyTime = measureSeconds([&]() {
+        for (size_t idx = 0; idx < raceCount; idx++)
+        {
+            auto winningRange = quadraticZeroPoints(1, -1 * races[idx].time, races[idx].distance);
+            legacy[idx]       = winningRange.second - winningRange.first + 1;
+        }
+    });
+    double                singleTime = measureSeconds([&]() {
+        for (size_t idx = 0; idx < raceCount; idx++)
+        {
+            single[idx] = findWiningSituations(races[idx]);
+        }
+    });
+    double                batchTime  = measureSeconds([&]() {
+        findWiningSituations(races.data(), batched.data(), raceCount);
+    });
 
-}
\ No newline at end of file
+    size_t mismatches = 0;
+    for (size_t idx = 0; idx < raceCount; idx++)
+    {
+        if (single[idx] != batched[idx])
+        {
+            throw std::logic_error("Batched and single race solvers disagree");
+        }
+        mismatches += (legacy[idx] != batched[idx]);
+    }
+    std::cout << "quadraticZeroPoints " << (raceCount / legacyTime) * 1e-6 << " Mraces/s, exact "
+              << (raceCount / singleTime) * 1e-6 << " Mraces/s, batched " << (raceCount / batchTime) * 1e-6
+              << " Mraces/s, original solver wrong on " << mismatches << " races" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    // Usage: day_06 [sheet file | -] [--bench [races]], the sheet defaults to input.txt and - reads it from stdin
+    std::string_view mode = (argc > 1) ? argv[1] : "";
+    if (mode == "--bench")
+    {
+        benchmark((argc > 2) ? std::stoul(argv[2]) : (1 << 22));
+        return 0;
+    }
+
+    RaceSheet sheet;
+    if (mode == "-")
+    {
+        sheet = parseRaceSheet(std::cin);
+    }
+    else
+    {
+        std::ifstream input(mode.empty() ? "input.txt" : argv[1]);
+        if (!input)
+        {
+            throw std::runtime_error("Unable to open " + std::string(mode.empty() ? "input.txt" : mode));
+        }
+        sheet = parseRaceSheet(input);
+    }
+
+    std::vector<uint64_t> counts(sheet.races.size());
+    findWiningSituations(sheet.races.data(), counts.data(), sheet.races.size());
+
+    size_t partOne = 1;
+    for (auto count : counts)
+    {
+        partOne *= count;
+    }
+
+    std::cout << "Part one: " << partOne << std::endl;
+    std::cout << "Part two: " << findWiningSituations(sheet.combined) << std::endl;
+}
@@ -1,12 +1,15 @@
 #include <algorithm>
+#include <array>
+#include <chrono>
+#include <charconv>
 #include <cinttypes>
 #include <fstream>
 #include <iostream>
-#include <map>
-#include <numeric>
-#include <set>
-#include <sstream>
+#include <random>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
 enum class HandType
@@ -53,327 +56,433 @@ constexpr std::ostream& operator<<(std::ostream& stream, HandType type)
 
 }
 
+// Hand packed into a single sortable key, the type in bits 20 and up followed by the five card ranks of 4 bits each,
+// first card most significant. Keys compare exactly as the hands rank, one key per rule set.
 struct HandBid
 {
-    std::string hand;
-    size_t      bid;
-    HandType    type;
+    uint32_t key;
+    uint32_t jokerKey;
+    uint32_t bid;
 };
 
-HandType calculateHandType(std::string const& hand)
-{
-    std::map<char, unsigned int> cardsCount;
-    for (char ch : hand)
-    {
-        cardsCount[ch] = cardsCount[ch] + 1;
-    }
+using HandKey = uint32_t HandBid::*;
 
-    // determine card type
-    auto countCards = [&cardsCount](size_t targetCount) {
-        return std::count_if(cardsCount.begin(), cardsCount.end(), [targetCount](auto const& mapPair) {
-            return mapPair.second == targetCount;
-        });
-    };
+constexpr unsigned kRankBits = 4;
+constexpr unsigned kTypeShift = 5 * kRankBits;
 
-    // check for five of a kind
-    if (countCards(5) > 0)
+using CardRanks = std::array<uint8_t, 256>;
+
+constexpr uint8_t kInvalidCard = 0xFF;
+
+// Rank of each card character, weakest card first, kInvalidCard for characters that aren't cards
+constexpr CardRanks makeCardRanks(std::string_view order)
+{
+    CardRanks ranks{};
+    for (auto& rank : ranks)
     {
-        return HandType::FiveOfAKind;
+        rank = kInvalidCard;
     }
-
-    if (countCards(4) > 0)
+    for (std::size_t idx = 0; idx < order.size(); idx++)
     {
-        return HandType::FourOfAKind;
+        ranks[static_cast<unsigned char>(order[idx])] = static_cast<uint8_t>(idx);
     }
+    return ranks;
+}
+
+constexpr CardRanks kCardRanks      = makeCardRanks("23456789TJQKA");
+constexpr CardRanks kJokerCardRanks = makeCardRanks("J23456789TQKA");
 
-    if (countCards(3) && countCards(2))
+uint32_t packHand(std::string_view hand, HandType type, CardRanks const& ranks)
+{
+    uint32_t key = static_cast<uint32_t>(type);
+    for (std::size_t idx = 0; idx < 5; idx++)
     {
-        return HandType::FullHouse;
+        key = (key << kRankBits) | ranks[static_cast<unsigned char>(hand[idx])];
     }
+    return key;
+}
 
-    if (countCards(3) > 0)
+// Type of a hand from its largest and second largest count of equal cards
+constexpr HandType classifyCounts(unsigned largest, unsigned second)
+{
+    if (largest >= 4)
     {
-        return HandType::ThreeOfAKind;
+        return (largest == 5) ? HandType::FiveOfAKind : HandType::FourOfAKind;
     }
-
-    if (countCards(2) > 1)
+    if (largest == 3)
     {
-        return HandType::TwoPair;
+        return (second == 2) ? HandType::FullHouse : HandType::ThreeOfAKind;
     }
-
-    if (countCards(2) == 1)
+    if (largest == 2)
     {
-        return HandType::OnePair;
+        return (second == 2) ? HandType::TwoPair : HandType::OnePair;
     }
-
     return HandType::HighCard;
 }
 
-HandType calculateHandTypeWithJoker(std::string const& hand)
+// Hand type indexed by [jokers][largest][second] count. Jokers always do best by joining the largest group, so their
+// entries are the plain classification with the jokers added to it.
+using HandTypeTable = std::array<std::array<std::array<HandType, 6>, 6>, 6>;
+
+constexpr HandTypeTable makeHandTypeTable()
 {
-    std::map<char, unsigned int> cardsCount;
-    for (char ch : hand)
+    HandTypeTable table{};
+    for (unsigned jokers = 0; jokers <= 5; jokers++)
     {
-        cardsCount[ch] = cardsCount[ch] + 1;
+        for (unsigned largest = 0; largest <= 5; largest++)
+        {
+            for (unsigned second = 0; second <= 5; second++)
+            {
+                table[jokers][largest][second] = classifyCounts(std::min(largest + jokers, 5U), second);
+            }
+        }
     }
+    return table;
+}
 
-    auto jokerCount = std::count(hand.begin(), hand.end(), 'J');
+constexpr HandTypeTable kHandTypes = makeHandTypeTable();
 
-    // determine card type
-    auto countCards = [&cardsCount](size_t targetCount) {
-        return std::count_if(cardsCount.begin(), cardsCount.end(), [targetCount](auto const& mapPair) {
-            return mapPair.second == targetCount;
-        });
-    };
+static_assert(kHandTypes[0][3][2] == HandType::FullHouse);
+static_assert(kHandTypes[1][2][2] == HandType::FullHouse);
+static_assert(kHandTypes[2][1][1] == HandType::ThreeOfAKind);
+static_assert(kHandTypes[5][0][0] == HandType::FiveOfAKind);
 
-    if (countCards(5) > 0)
+// Count of each card rank as 4 bit fields of a single integer, then the two largest counts are picked without
+// branching. With jokers their count is taken out of the histogram and looked up separately.
+template <bool Jokers>
+HandType classifyHand(std::string_view hand)
+{
+    CardRanks const& ranks = Jokers ? kJokerCardRanks : kCardRanks;
+
+    uint64_t histogram = 0;
+    for (std::size_t idx = 0; idx < 5; idx++)
     {
-        return HandType::FiveOfAKind;
+        histogram += uint64_t{1} << (kRankBits * ranks[static_cast<unsigned char>(hand[idx])]);
     }
 
-    // Joker can raise the level of the hand
-    if (countCards(4) > 0)
+    unsigned jokers = 0;
+    if constexpr (Jokers)
     {
-        if (jokerCount == 4)
-        {
-            return HandType::FiveOfAKind;
-        }
-        if (jokerCount == 1)
-        {
-            return HandType::FiveOfAKind;
-        }
-        return HandType::FourOfAKind;
+        // Joker is the weakest card so it sits in the lowest field
+        jokers = histogram & 0xF;
+        histogram &= ~uint64_t{0xF};
     }
 
-    if (countCards(3) && countCards(2))
+    unsigned largest = 0;
+    unsigned second  = 0;
+    for (unsigned rank = 0; rank < 13; rank++)
     {
-        if (jokerCount == 3 || jokerCount == 2)
-        {
-            return HandType::FiveOfAKind;
-        }
-        return HandType::FullHouse;
+        unsigned count = (histogram >> (kRankBits * rank)) & 0xF;
+        second         = std::max(second, std::min(largest, count));
+        largest        = std::max(largest, count);
     }
+    return kHandTypes[jokers][largest][second];
+}
 
-    if (countCards(3) > 0)
+HandType calculateHandType(std::string_view hand)
+{
+    return classifyHand<false>(hand);
+}
+
+HandType calculateHandTypeWithJoker(std::string_view hand)
+{
+    return classifyHand<true>(hand);
+}
+
+// Stable LSD radix sort of the hands by one of their keys, two passes of 12 bits cover the whole key
+void radixSort(std::vector<HandBid>& hands, HandKey key)
+{
+    constexpr unsigned kDigitBits = 12;
+    constexpr uint32_t kDigitMask = (1U << kDigitBits) - 1;
+    static_assert((2 * kDigitBits) > (kTypeShift + 3), "Radix passes have to cover the hand type");
+
+    std::vector<HandBid>  buffer(hands.size());
+    std::vector<uint32_t> offsets(kDigitMask + 1);
+    for (unsigned shift = 0; shift < (2 * kDigitBits); shift += kDigitBits)
     {
-        if (jokerCount == 3)
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (auto const& hand : hands)
         {
-            return HandType::FourOfAKind;
+            offsets[((hand.*key) >> shift) & kDigitMask]++;
         }
-        if (jokerCount == 2)
+        uint32_t position = 0;
+        for (auto& offset : offsets)
         {
-            return HandType::FullHouse;
+            position += std::exchange(offset, position);
         }
-        if (jokerCount == 1)
+        for (auto const& hand : hands)
         {
-            return HandType::FourOfAKind;
+            buffer[offsets[((hand.*key) >> shift) & kDigitMask]++] = hand;
         }
-        return HandType::ThreeOfAKind;
+        hands.swap(buffer);
     }
+}
 
-    if (countCards(2) > 1)
+// Sum of bid times rank over hands sorted weakest first
+uint64_t totalWinnings(std::vector<HandBid> const& hands)
+{
+    uint64_t winnings = 0;
+    for (std::size_t idx = 0; idx < hands.size(); idx++)
     {
-        if (jokerCount == 2)
-        {
-            // one of tha pairs are joker, turn it into four of a kind
-            return HandType::FourOfAKind;
-        }
-        if (jokerCount == 1)
-        {
-            return HandType::FullHouse;
-        }
-        return HandType::TwoPair;
+        winnings += uint64_t{hands[idx].bid} * (idx + 1);
     }
+    return winnings;
+}
 
-    if (countCards(2) == 1)
+// Both keys of a hand are packed from a single read of it
+HandBid makeHandBid(std::string_view hand, uint32_t bid)
+{
+    return HandBid{packHand(hand, calculateHandType(hand), kCardRanks),
+                   packHand(hand, calculateHandTypeWithJoker(hand), kJokerCardRanks),
+                   bid};
+}
+
+// Hand at the start of the line, the cards are validated here as the classifier and packing assume valid ranks
+std::string_view parseHand(std::string_view line)
+{
+    if ((line.size() < 5) || ((line.size() > 5) && (line[5] != ' ')))
     {
-        if (jokerCount == 2)
-        {
-            return HandType::ThreeOfAKind;
-        }
-        if (jokerCount == 1)
+        throw std::runtime_error("Malformed hand: " + std::string(line));
+    }
+    for (std::size_t idx = 0; idx < 5; idx++)
+    {
+        if (kCardRanks[static_cast<unsigned char>(line[idx])] == kInvalidCard)
         {
-            return HandType::ThreeOfAKind;
+            throw std::runtime_error("Invalid card in hand: " + std::string(line));
         }
-        return HandType::OnePair;
+    }
+    return line.substr(0, 5);
+}
+
+// Line of "<hand> <bid>"
+HandBid parseHandBid(std::string const& line)
+{
+    std::string_view view(line);
+    auto             hand = parseHand(view);
+    if (view.size() < 7)
+    {
+        throw std::runtime_error("Malformed hand: " + line);
     }
 
-    if (jokerCount == 1)
+    uint32_t bid      = 0;
+    auto [end, error] = std::from_chars(view.data() + 6, view.data() + view.size(), bid);
+    if (error != std::errc())
     {
-        return HandType::OnePair;
+        throw std::runtime_error("Malformed hand: " + line);
     }
-    return HandType::HighCard;
+    return makeHandBid(hand, bid);
 }
 
-struct ComparePart1 : public std::binary_function<HandBid, HandBid, bool>
+// Every hand is kept even when it repeats
+std::vector<HandBid> parseGameInput(std::istream& input)
 {
-    bool operator()(HandBid const& left, HandBid const& right) const
+    std::vector<HandBid> hands;
+    std::string          line;
+    while (std::getline(input, line))
     {
-        if (left.type < right.type)
+        if (line.size() >= 7)
         {
-            return true;
+            hands.push_back(parseHandBid(line));
         }
+    }
+    return hands;
+}
 
-        if (left.type > right.type)
+template <typename T>
+class FenwickTree
+{
+public:
+    explicit FenwickTree(std::size_t size)
+        : mTree(size + 1)
+    {
+    }
+
+    void add(std::size_t idx, T value)
+    {
+        for (idx++; idx < mTree.size(); idx += idx & (~idx + 1))
         {
-            return false;
+            mTree[idx] += value;
         }
+    }
 
-        // Hands are of equal type, calculate first higher card
-        static const std::map<char, unsigned int> cardLookup{
-            {'2', 0},
-            {'3', 1},
-            {'4', 2},
-            {'5', 3},
-            {'6', 4},
-            {'7', 5},
-            {'8', 6},
-            {'9', 7},
-            {'T', 8},
-            {'J', 9},
-            {'Q', 10},
-            {'K', 11},
-            {'A', 12}};
-
-        for (std::size_t idx = 0; idx < left.hand.size(); idx++)
+    // Sum over [0, end)
+    T prefix(std::size_t end) const
+    {
+        T sum{};
+        for (; end > 0; end -= end & (~end + 1))
         {
-            if (cardLookup.at(left.hand[idx]) < cardLookup.at(right.hand[idx]))
-            {
-                // left is weaker than right
-                return true;
-            }
-
-            if (cardLookup.at(left.hand[idx]) > cardLookup.at(right.hand[idx]))
-            {
-                // right is higher than left
-                return false;
-            }
+            sum += mTree[end];
         }
-        return false;  // Should never be reached otherwise cards are the same
+        return sum;
     }
-};
 
-std::set<HandBid, ComparePart1> parseGameInputPart1()
-{
-    std::set<HandBid, ComparePart1> hands;
-    std::fstream                    input("input.txt");
-    std::string                     line;
-    while (std::getline(input, line))
+    T total() const
     {
-        if (!line.empty())
-        {
-            // split
-            HandBid           inputHand;
-            std::stringstream ss{line};
-            ss >> inputHand.hand;
-            std::string token;
-            ss >> token;
-            inputHand.bid = std::stoull(token);
+        return prefix(mTree.size() - 1);
+    }
 
-            inputHand.type = calculateHandType(inputHand.hand);
+private:
+    std::vector<T> mTree;
+};
 
-            hands.insert(inputHand);
-        }
+// Running total winnings of a growing set of hands. Hand keys are mapped densely onto type * 13^5 plus the ranks read
+// as base 13 digits, with Fenwick trees over that space counting hands and summing their bids. Equal hands rank in
+// insertion order, as the stable sort would place them.
+class Leaderboard
+{
+public:
+    static constexpr std::size_t kHandsPerType = 13 * 13 * 13 * 13 * 13;
+    static constexpr std::size_t kKeySpace     = 7 * kHandsPerType;
+
+    Leaderboard()
+        : mCounts(kKeySpace)
+        , mBids(kKeySpace)
+    {
     }
-    return hands;
-}
 
-struct ComparePart2 : public std::binary_function<HandBid, HandBid, bool>
-{
-    bool operator()(HandBid const& left, HandBid const& right) const
+    static std::size_t denseIndex(uint32_t key)
     {
-        if (left.type < right.type)
+        std::size_t idx = key >> kTypeShift;
+        for (int card = 4; card >= 0; card--)
         {
-            return true;
+            idx = idx * 13 + ((key >> (card * kRankBits)) & 0xF);
         }
+        return idx;
+    }
 
-        if (left.type > right.type)
-        {
-            return false;
-        }
+    // A new hand lifts everything stronger by one rank and lands above all hands up to its own key
+    void insert(uint32_t key, uint32_t bid)
+    {
+        auto idx = denseIndex(key);
+        mTotal += (mBids.total() - mBids.prefix(idx + 1)) + uint64_t{bid} * (mCounts.prefix(idx + 1) + 1);
+        mCounts.add(idx, 1);
+        mBids.add(idx, bid);
+    }
 
-        // Hands are of equal type, calculate first higher card
-        static const std::map<char, unsigned int> cardLookup{
-            {'J', 0},
-            {'2', 1},
-            {'3', 2},
-            {'4', 3},
-            {'5', 4},
-            {'6', 5},
-            {'7', 6},
-            {'8', 7},
-            {'9', 8},
-            {'T', 9},
-            {'Q', 10},
-            {'K', 11},
-            {'A', 12}};
-
-        for (std::size_t idx = 0; idx < left.hand.size(); idx++)
-        {
-            if (cardLookup.at(left.hand[idx]) < cardLookup.at(right.hand[idx]))
-            {
-                // left is weaker than right
-                return true;
-            }
+    // Rank of the weakest hand with this key, or of where such a hand would go
+    uint64_t rankOf(uint32_t key) const
+    {
+        return mCounts.prefix(denseIndex(key)) + 1;
+    }
 
-            if (cardLookup.at(left.hand[idx]) > cardLookup.at(right.hand[idx]))
-            {
-                // right is higher than left
-                return false;
-            }
-        }
-        return false;  // Should never be reached otherwise cards are the same
+    uint64_t totalWinnings() const
+    {
+        return mTotal;
     }
+
+private:
+    FenwickTree<uint32_t> mCounts;
+    FenwickTree<uint64_t> mBids;
+    uint64_t              mTotal = 0;
 };
 
-std::set<HandBid, ComparePart2> parseGameInputPart2()
+// Batches of hands separated by empty lines, winnings of both rule sets are reported after each batch. A line of
+// "? <hand>" reports the rank of the hand in both rule sets among the hands read so far.
+void streamInput(std::istream& input)
 {
-    std::set<HandBid, ComparePart2> hands;
-    std::fstream                    input("input.txt");
-    std::string                     line;
+    Leaderboard standard;
+    Leaderboard joker;
+    std::size_t batch   = 0;
+    bool        pending = false;
+    std::string line;
+    auto        report  = [&]() {
+        std::cout << "Batch " << ++batch << ": first part " << standard.totalWinnings() << ", second part "
+                  << joker.totalWinnings() << std::endl;
+        pending = false;
+    };
+
     while (std::getline(input, line))
     {
-        if (!line.empty())
+        if (line.substr(0, 2) == "? ")
         {
-            // split
-            HandBid           inputHand;
-            std::stringstream ss{line};
-            ss >> inputHand.hand;
-            std::string token;
-            ss >> token;
-            inputHand.bid = std::stoull(token);
-
-            inputHand.type = calculateHandTypeWithJoker(inputHand.hand);
-
-            hands.insert(inputHand);
+            auto hand = makeHandBid(parseHand(std::string_view(line).substr(2)), 0);
+            std::cout << "Rank of " << line.substr(2, 5) << ": first part " << standard.rankOf(hand.key)
+                      << ", second part " << joker.rankOf(hand.jokerKey) << std::endl;
+            continue;
+        }
+        if (line.size() < 7)
+        {
+            if (pending)
+            {
+                report();
+            }
+            continue;
         }
+
+        auto hand = parseHandBid(line);
+        standard.insert(hand.key, hand.bid);
+        joker.insert(hand.jokerKey, hand.bid);
+        pending = true;
+    }
+    if (pending)
+    {
+        report();
     }
-    return hands;
 }
 
-int main()
+template <typename Function>
+double measureSeconds(Function&& function)
 {
-    auto handsPart1 = parseGameInputPart1();
+    auto start = std::chrono::steady_clock::now();
+    function();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
 
-    size_t winningsPart1 = 0;
-    size_t rank          = 1;
+// Hands per second ranked by radixSort against std::stable_sort on the same keys
+void benchmark(std::size_t handCount)
+{
+    std::mt19937                    random(2023);
+    std::uniform_int_distribution<> cards(0, 12);
+    std::vector<HandBid>            hands(handCount);
+    for (auto& hand : hands)
+    {
+        std::string cardsInHand(5, ' ');
+        for (auto& card : cardsInHand)
+        {
+            card = "23456789TJQKA"[cards(random)];
+        }
+        hand = makeHandBid(cardsInHand, static_cast<uint32_t>(random() % 1000));
+    }
 
-    winningsPart1 = std::accumulate(handsPart1.begin(), handsPart1.end(), 0, [&rank](auto const& sum, HandBid const& hand) {
-        return sum + hand.bid * rank++;
+    auto   radixSorted = hands;
+    double radixTime   = measureSeconds([&]() { radixSort(radixSorted, &HandBid::key); });
+    auto   stableSorted = hands;
+    double stableTime   = measureSeconds([&]() {
+        std::stable_sort(stableSorted.begin(), stableSorted.end(), [](HandBid const& left, HandBid const& right) {
+            return left.key < right.key;
+        });
     });
 
-    std::cout << "First part: " << winningsPart1 << std::endl;
+    std::cout << "radixSort " << (handCount / radixTime) * 1e-6 << " Mhands/s, std::stable_sort "
+              << (handCount / stableTime) * 1e-6 << " Mhands/s, winnings " << totalWinnings(radixSorted) << " / "
+              << totalWinnings(stableSorted) << std::endl;
+}
 
-    auto handsPart2 = parseGameInputPart2();
+int main(int argc, char** argv)
+{
+    // Usage: day_07 [--bench [hands] | --incremental], the incremental mode reads batches of hands and "? <hand>"
+    // rank queries from stdin
+    std::string_view mode = (argc > 1) ? argv[1] : "";
+    if (mode == "--bench")
+    {
+        benchmark((argc > 2) ? std::stoul(argv[2]) : (1 << 22));
+        return 0;
+    }
+    if (mode == "--incremental")
+    {
+        streamInput(std::cin);
+        return 0;
+    }
 
-    size_t winningsPart2 = 0;
-    rank          = 1;
+    std::fstream input("input.txt");
+    auto         hands = parseGameInput(input);
 
-    winningsPart2 = std::accumulate(handsPart2.begin(), handsPart2.end(), 0, [&rank](auto const& sum, HandBid const& hand) {
-        return sum + hand.bid * rank++;
-    });
+    radixSort(hands, &HandBid::key);
+    std::cout << "First part: " << totalWinnings(hands) << std::endl;
 
-    std::cout << "Second part: " << winningsPart2 << std::endl;
+    radixSort(hands, &HandBid::jokerKey);
+    std::cout << "Second part: " << totalWinnings(hands) << std::endl;
 
     return 0;
-}
\ No newline at end of file
+}
@@ -5,37 +5,55 @@
  * and detect the cycle for each of the paths for nodes starting with (**A) and ending with (**Z)
  */
 #include <algorithm>
+#include <array>
+#include <cinttypes>
 #include <fstream>
 #include <iostream>
 #include <numeric>
-#include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
-struct Node
-{
-    std::string value;
-    std::string left;
-    std::string right;
-};
+// Three character node names read as base 36 numbers, so every name fits a 16-bit id. Letters alone would need
+// only 26^3 slots, digits are allowed as well since the example networks use names like 11A.
+constexpr std::size_t kNameBase  = 36;
+constexpr std::size_t kNodeSlots = kNameBase * kNameBase * kNameBase;
+static_assert(kNodeSlots <= 65536, "Node ids have to fit 16 bits");
 
-bool operator<(Node const& left, Node const& right)
+constexpr uint16_t nameDigit(char c)
 {
-    return left.value < right.value;
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if ((c >= 'A') && (c <= 'Z'))
+    {
+        return 10 + (c - 'A');
+    }
+    throw std::out_of_range("Invalid node name");
 }
 
-bool operator<(Node const left, std::string const& key)
+constexpr uint16_t nodeId(std::string_view name)
 {
-    return left.value < key;
+    return (nameDigit(name[0]) * kNameBase + nameDigit(name[1])) * kNameBase + nameDigit(name[2]);
 }
 
-bool operator<(std::string const& key, Node const& right)
+// Last character of a node name
+constexpr bool endsWith(uint16_t node, char c)
 {
-    return key < right.value;
+    return (node % kNameBase) == nameDigit(c);
 }
 
-using Network = std::set<Node, std::less<>>;
+// Left and right neighbours indexed by node id and by direction, 0 for left and 1 for right
+struct Network
+{
+    std::array<std::vector<uint16_t>, 2> next{std::vector<uint16_t>(kNodeSlots), std::vector<uint16_t>(kNodeSlots)};
+    std::vector<bool>                    known = std::vector<bool>(kNodeSlots);
+    std::vector<uint16_t>                nodes;
+};
 
 // Didn't really feel like parsing this part, so C/P
 std::string getInstructions()
@@ -43,6 +61,17 @@ std::string getInstructions()
     return "LLRLRRRLRRRLRRLLRRRLLRRLLRLRLRRRLRRRLLRRRLLRRRLRRLRRLRLRRLLRRRLRRRLLRRRLRRLLLRRLRLLLRLRRRLRLRLLLRRLRRLLLRRRLLRRRLRLRLLRRLRLRRRLRLRLLRLRRLRRRLRRLRLRRRLRLRRLRRLRLRRLLRLRLRRLRLLRRLRRLRLRRLLRLRLLRRLLRLLLRRLRLRRRLRRRLRRRLRLRLRRRLLLRLRRLRLRRRLRRRLRRRLRLRRRLRRRLRRRLRRRR";
 }
 
+// Instructions as directions indexing Network::next
+std::vector<uint8_t> toDirections(std::string const& instructions)
+{
+    std::vector<uint8_t> directions;
+    for (char instruction : instructions)
+    {
+        directions.push_back(instruction != 'L');
+    }
+    return directions;
+}
+
 Network parseNetwork()
 {
     Network      network;
@@ -54,121 +83,102 @@ Network parseNetwork()
         {
             // split
             std::stringstream ss{line};
+            std::string       value;
+            std::string       left;
+            std::string       right;
             std::string       token;
 
-            // Node
-            Node node;
-            ss >> node.value;
+            ss >> value;
             ss >> token;  // discard =
-            ss >> token;  // (left,
-            node.left = token.substr(1, 3);
-            ss >> token;  // right)
-            node.right = token.substr(0, 3);
-
-            network.insert(node);
+            ss >> left;   // (left,
+            ss >> right;  // right)
+
+            auto node             = nodeId(value);
+            network.next[0][node] = nodeId(std::string_view(left).substr(1, 3));
+            network.next[1][node] = nodeId(std::string_view(right).substr(0, 3));
+            network.nodes.push_back(node);
+            network.known[node] = true;
         }
     }
 
+    // Checked once here so walking the network needs no lookups
+    for (auto node : network.nodes)
+    {
+        if (!network.known[network.next[0][node]] || !network.known[network.next[1][node]])
+        {
+            throw std::out_of_range("Got lost in the network");
+        }
+    }
     return network;
 }
 
 class Solver
 {
 public:
-    Solver(Network const& network, std::string const& instructions)
+    Solver(Network const& network, std::vector<uint8_t> const& directions)
     : mNetwork(network)
-    , mInstructions(instructions)
+    , mDirections(directions)
     {
     }
 
     size_t findPath()
     {
-        return findNode(mInstructions.begin(), "AAA");
+        auto const target = nodeId("ZZZ");
+        return walk(nodeId("AAA"), [target](uint16_t node) { return node == target; }).second;
     }
 
-    std::vector<std::pair<Node, size_t>> findPaths()
+    std::vector<std::pair<uint16_t, size_t>> findPaths()
     {
-        std::vector<std::pair<Node, size_t>> cycles;
-        for (auto const& node : mNetwork)
+        std::vector<std::pair<uint16_t, size_t>> cycles;
+        for (auto node : mNetwork.nodes)
         {
-            if (node.value.back() == 'A')
+            if (endsWith(node, 'A'))
             {
-                cycles.emplace_back(findCycle(mInstructions.begin(), node));
+                // Walk until the first node ending with Z
+                cycles.emplace_back(walk(node, [](uint16_t node) { return endsWith(node, 'Z'); }));
             }
         }
         return cycles;
     }
 
 private:
-    size_t findNode(std::string::const_iterator command, std::string const& node)
+    // Follows the directions until a node satisfies isEnd, returns it with the steps taken. Each step is one indexed
+    // load, the direction picks the array.
+    template <typename EndCondition>
+    std::pair<uint16_t, size_t> walk(uint16_t node, EndCondition isEnd) const
     {
-        auto nodeItr = mNetwork.find(node);
-        if (nodeItr == mNetwork.end())
+        if (!mNetwork.known[node])
         {
             throw std::out_of_range("Got lost in the network");
         }
 
-        if (nodeItr->value == "ZZZ")
-        {
-            return 0;
-        }
-
-        if (command == mInstructions.end())
-        {
-            // wrap around if end is reached
-            command = mInstructions.begin();
-        }
-
-        if (*command == 'L')
-        {
-            return 1 + findNode(++command, nodeItr->left);
-        }
-        else
-        {
-            return 1 + findNode(++command, nodeItr->right);
-        }
-    }
-
-    std::pair<Node, size_t> findCycle(std::string::const_iterator command, Node const& node)
-    {
-        if (node.value.back() == 'Z')
+        uint16_t const* next[2] = {mNetwork.next[0].data(), mNetwork.next[1].data()};
+        size_t          steps   = 0;
+        while (true)
         {
-            // Found the first number ending with Z
-            return {node, 0};
-        }
-
-        if (command >= mInstructions.end())
-        {
-            command = mInstructions.begin();
-        }
-
-        if (*command == 'L')
-        {
-            auto& leftNode         = *mNetwork.find(node.left);
-            auto  lastNodeAndCycle = findCycle(++command, leftNode);
-            lastNodeAndCycle.second++;
-            return lastNodeAndCycle;
-        }
-        else
-        {
-            auto& rightNode        = *mNetwork.find(node.right);
-            auto  lastNodeAndCycle = findCycle(++command, rightNode);
-            lastNodeAndCycle.second++;
-            return lastNodeAndCycle;
+            for (auto direction : mDirections)
+            {
+                if (isEnd(node))
+                {
+                    return {node, steps};
+                }
+                node = next[direction][node];
+                steps++;
+            }
         }
     }
 
 private:
-    Network const&     mNetwork;
-    std::string const& mInstructions;
+    Network const&              mNetwork;
+    std::vector<uint8_t> const& mDirections;
 };
 
 int main()
 {
-    auto network      = parseNetwork();
-    auto instructions = getInstructions();
+    auto network    = parseNetwork();
+    auto directions = toDirections(getInstructions());
 
-    Solver solver(network, instructions);
+    Solver solver(network, directions);
     auto   stepsTakenPartOne = solver.findPath();
     auto   endNodesAndCycles = solver.findPaths();
 